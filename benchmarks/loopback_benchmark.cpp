@@ -0,0 +1,67 @@
+#include <benchmark/benchmark.h>
+#include "../src/websocket/websocket_client.h"
+#include "../src/util/root_certificates.hpp"
+#include "../tests/local_echo_server.h"
+#include <iostream>
+#include <string>
+
+namespace {
+
+// JSON-shaped payload with the occasional non-ASCII character.
+std::string make_payload(std::size_t size) {
+    static const std::string record = R"({"symbol":"BTC-USD","bid":64250.5,"ask":64251.0,"venue":"Zürich"},)";
+    std::string payload;
+    while (payload.size() < size) payload += record;
+    payload.resize(size);
+    // Avoid cutting a multi-byte character in half at the end.
+    while (!payload.empty() && (static_cast<unsigned char>(payload.back()) & 0x80)) payload.pop_back();
+    return payload;
+}
+
+}
+
+// One send/echo round trip through WebSocketClient and a TLS echo server on
+// 127.0.0.1: masking, TLS, and on the way back Beast's UTF-8 check for text
+// frames. The text/binary difference is what that check costs.
+static void BM_LoopbackEcho(benchmark::State& state) {
+    const std::string payload = make_payload(static_cast<std::size_t>(state.range(0)));
+    const bool binary = state.range(1) != 0;
+
+    // The client logs every write; keep that out of the measurement.
+    std::streambuf* saved_cout = std::cout.rdbuf(nullptr);
+
+    LocalEchoServer server(false);
+    net::io_context ioc;
+    ssl::context ctx{ssl::context::tlsv13_client};
+    load_root_certificates(ctx);
+    ctx.set_verify_mode(ssl::verify_peer);
+    server.trust(ctx);
+
+    auto client = std::make_shared<WebSocketClient>(ioc, ctx);
+    std::size_t received = 0;
+    client->set_message_callback([&received](const std::string&) { ++received; });
+    client->connect("localhost", server.port());
+    while (!client->is_connected() && ioc.run_one()) {
+    }
+
+    if (!client->is_connected()) {
+        state.SkipWithError("could not connect to the local echo server");
+    } else {
+        for (auto _ : state) {
+            const std::size_t target = received + 1;
+            client->send(payload, binary);
+            while (received < target && ioc.run_one()) {
+            }
+        }
+        state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * payload.size()));
+        client->close();
+    }
+    ioc.run();
+
+    std::cout.rdbuf(saved_cout);
+    std::cout.clear();
+}
+BENCHMARK(BM_LoopbackEcho)
+    ->ArgsProduct({{256, 4 * 1024, 64 * 1024}, {0, 1}})
+    ->ArgNames({"bytes", "binary"})
+    ->UseRealTime();
@@ -0,0 +1,31 @@
+#include <benchmark/benchmark.h>
+#include "../src/util/trace.h"
+
+// Cost of a trace point while no session is running.
+static void BM_TraceScopeDisabled(benchmark::State& state) {
+    trace::stop();
+    for (auto _ : state) {
+        WS_TRACE_SCOPE("bench", "bench");
+    }
+}
+BENCHMARK(BM_TraceScopeDisabled);
+
+static void BM_TraceScopeEnabled(benchmark::State& state) {
+    trace::start();
+    for (auto _ : state) {
+        WS_TRACE_SCOPE("bench", "bench");
+    }
+    trace::stop();
+}
+BENCHMARK(BM_TraceScopeEnabled);
+
+static void BM_TraceBeginEndEnabled(benchmark::State& state) {
+    [[maybe_unused]] int id = 0;
+    trace::start();
+    for (auto _ : state) {
+        WS_TRACE_BEGIN("bench", "bench", &id);
+        WS_TRACE_END("bench", "bench", &id);
+    }
+    trace::stop();
+}
+BENCHMARK(BM_TraceBeginEndEnabled);
@@ -0,0 +1,81 @@
+#include <benchmark/benchmark.h>
+#include "../src/util/util.h"
+#include <string>
+
+namespace {
+
+const std::string kCommandLine = "  send {\"op\":\"subscribe\",\"channel\":\"ticker\"}  ";
+const std::string kSymbols = "BTC-USD,ETH-USD,SOL-USD,ADA-USD,DOGE-USD,XRP-USD,DOT-USD,LTC-USD";
+const std::string kClientKey = "dGhlIHNhbXBsZSBub25jZQ==";
+
+}
+
+static void BM_Trim(benchmark::State& state) {
+    for (auto _ : state) benchmark::DoNotOptimize(util::trim(kCommandLine));
+}
+BENCHMARK(BM_Trim);
+
+static void BM_TrimView(benchmark::State& state) {
+    for (auto _ : state) benchmark::DoNotOptimize(util::trimView(kCommandLine));
+}
+BENCHMARK(BM_TrimView);
+
+static void BM_Split(benchmark::State& state) {
+    for (auto _ : state) benchmark::DoNotOptimize(util::split(kSymbols, ','));
+}
+BENCHMARK(BM_Split);
+
+static void BM_SplitView(benchmark::State& state) {
+    for (auto _ : state) benchmark::DoNotOptimize(util::splitView(kSymbols, ','));
+}
+BENCHMARK(BM_SplitView);
+
+static void BM_GenerateWebSocketKey(benchmark::State& state) {
+    for (auto _ : state) benchmark::DoNotOptimize(util::generateWebSocketKey());
+}
+BENCHMARK(BM_GenerateWebSocketKey);
+
+static void BM_ComputeAcceptKey(benchmark::State& state) {
+    for (auto _ : state) benchmark::DoNotOptimize(util::computeAcceptKey(kClientKey));
+}
+BENCHMARK(BM_ComputeAcceptKey);
+
+static void BM_ComputeAcceptKeyInto(benchmark::State& state) {
+    char out[util::kAcceptKeySize];
+    for (auto _ : state) {
+        util::computeAcceptKey(std::string_view(kClientKey), out);
+        benchmark::DoNotOptimize(out);
+    }
+}
+BENCHMARK(BM_ComputeAcceptKeyInto);
+
+static void BM_Base64Encode(benchmark::State& state) {
+    std::string data(static_cast<std::size_t>(state.range(0)), 'x');
+    for (auto _ : state) benchmark::DoNotOptimize(util::base64Encode(data));
+}
+BENCHMARK(BM_Base64Encode)->Arg(16)->Arg(1024);
+
+static void BM_Base64Decode(benchmark::State& state) {
+    std::string encoded = util::base64Encode(std::string(static_cast<std::size_t>(state.range(0)), 'x'));
+    for (auto _ : state) benchmark::DoNotOptimize(util::base64Decode(encoded));
+}
+BENCHMARK(BM_Base64Decode)->Arg(16)->Arg(1024);
+
+// Filtered out by the level check, i.e. the cost of a disabled log call.
+static void BM_LogFiltered(benchmark::State& state) {
+    util::setLogLevel(util::LogLevel::LOG_ERROR);
+    for (auto _ : state) util::log(util::LogLevel::LOG_DEBUG, kCommandLine);
+    util::setLogLevel(util::LogLevel::LOG_INFO);
+}
+BENCHMARK(BM_LogFiltered);
+
+static void BM_SetLogLevel(benchmark::State& state) {
+    for (auto _ : state) util::setLogLevel(util::LogLevel::LOG_INFO);
+}
+BENCHMARK(BM_SetLogLevel);
+
+static void BM_ParseWebSocketUrl(benchmark::State& state) {
+    const std::string url = "wss://stream.example.com:443/ws/market";
+    for (auto _ : state) benchmark::DoNotOptimize(util::parseWebSocketUrl(url));
+}
+BENCHMARK(BM_ParseWebSocketUrl);
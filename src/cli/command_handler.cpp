@@ -1,44 +1,89 @@
 #include "command_handler.h"
 #include "../websocket/websocket_client.h"
+#include "../websocket/conflating_dispatcher.h"
+#include "../util/trace.h"
 #include <iostream>
-#include <sstream>
+#include <string_view>
 #include <thread>
 #include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <unistd.h>
 #include <boost/asio.hpp>
 
 namespace net = boost::asio;
 
-CommandHandler::CommandHandler(std::shared_ptr<WebSocketClient> client, net::io_context& ioc)
-    : client_(std::move(client)), ioc_(ioc) {
+namespace {
+
+constexpr const char* kWhitespace = " \t\r\n\v\f";
+
+// Pops the next whitespace-delimited token off the front of `rest`.
+std::string_view next_token(std::string_view& rest) {
+    auto begin = rest.find_first_not_of(kWhitespace);
+    if (begin == std::string_view::npos) {
+        rest = {};
+        return {};
+    }
+    rest.remove_prefix(begin);
+    auto token = rest.substr(0, rest.find_first_of(kWhitespace));
+    rest.remove_prefix(token.size());
+    return token;
+}
+
+void print_message(const std::string& message) {
+    std::cout << "Received: " << message << std::endl;
+}
+
+std::string_view skip_whitespace(std::string_view rest) {
+    auto begin = rest.find_first_not_of(kWhitespace);
+    return begin == std::string_view::npos ? std::string_view{} : rest.substr(begin);
+}
+
+}
+
+CommandHandler::CommandHandler(std::shared_ptr<WebSocketClient> client, net::io_context& ioc, int input_fd)
+    : client_(std::move(client)), ioc_(ioc), input_fd_(input_fd), input_(ioc), signals_(ioc, SIGUSR1),
+      interactive_(::isatty(input_fd) == 1) {
+    wait_for_signal();
+}
+
+bool CommandHandler::is_interactive() const {
+    return interactive_;
+}
+
+void CommandHandler::prompt() const {
+    if (interactive_) std::cout << "> " << std::flush;
 }
 
 void CommandHandler::process_command(const std::string& command) {
-    if (command.empty()) {
-        std::cout << "> " << std::flush;  
+    std::string_view rest(command);
+    // Scripts written with CRLF line endings.
+    if (!rest.empty() && rest.back() == '\r') rest.remove_suffix(1);
+
+    if (rest.empty()) {
+        prompt();
         return;
     }
 
-    std::istringstream iss(command);
-    std::string cmd;
-    iss >> cmd;
+    std::string_view cmd = next_token(rest);
 
     if (cmd == "help" || cmd == "?") {
         print_help();
-        std::cout << "> " << std::flush;
+        prompt();
     } 
     else if (cmd == "connect") {
-        std::string host, port;
-        iss >> host >> port;
+        std::string host(next_token(rest));
+        std::string port(next_token(rest));
 
         if (host.empty() || port.empty()) {
             std::cout << "Usage: connect <host> <port>\n";
-            std::cout << "> " << std::flush;
+            prompt();
             return;
         }
 
         if (client_->is_connected()) {
             std::cout << "Already connected. Use 'close' to disconnect first.\n";
-            std::cout << "> " << std::flush;
+            prompt();
             return;
         }
 
@@ -47,78 +92,122 @@ void CommandHandler::process_command(const std::string& command) {
 
         std::cout << "Connecting to " << host << ":" << port << "...\n";
         client_->connect(host, port);
-        std::cout << "> " << std::flush;
+        prompt();
     } 
     else if (cmd == "send") {
-        std::string message;
-        std::getline(iss >> std::ws, message);
+        std::string message(skip_whitespace(rest));
 
         if (message.empty()) {
             std::cout << "Usage: send <message>\n";
-            std::cout << "> " << std::flush;
+            prompt();
             return;
         }
 
-        if (!client_->is_connected()) {
+        if (!has_connection()) {
             std::cout << "Not connected. Use 'connect' first.\n";
-            std::cout << "> " << std::flush;
+            prompt();
             return;
         }
 
         client_->send(message, false);  
-        std::cout << "> " << std::flush;
+        prompt();
     } 
     else if (cmd == "sendbin") {
-        std::string message;
-        std::getline(iss >> std::ws, message);
+        std::string message(skip_whitespace(rest));
     
         if (message.empty()) {
             std::cout << "Usage: sendbin <message> (or 'test' for a binary example)\n";
-            std::cout << "> " << std::flush;
+            prompt();
             return;
         }
     
-        if (!client_->is_connected()) {
+        if (!has_connection()) {
             std::cout << "Not connected. Use 'connect' first.\n";
-            std::cout << "> " << std::flush;
+            prompt();
             return;
         }
 
         client_->send(message, true);
         std::cout << "Sent binary: " << message << "\n";
-        std::cout << "> " << std::flush;
+        prompt();
     }
     else if (cmd == "close") {
-        if (!client_->is_connected()) {
+        if (!has_connection()) {
             std::cout << "No active connection to close.\n";
-            std::cout << "> " << std::flush;
+            prompt();
             return;
         }
 
         std::cout << "Closing connection...\n";
         client_->close();
-        std::cout << "> " << std::flush;
+        prompt();
     } 
+    else if (cmd == "conflate") {
+        std::string field(next_token(rest));
+
+        if (field.empty()) {
+            std::cout << "Usage: conflate <json-key-field> | conflate off\n";
+            prompt();
+            return;
+        }
+
+        if (field == "off") {
+            set_conflation(nullptr);
+            std::cout << "Conflation disabled.\n";
+        } else {
+            set_conflation(std::make_shared<ConflatingDispatcher>(ConflatingDispatcher::json_field(field), print_message));
+            std::cout << "Conflating messages by \"" << field << "\".\n";
+        }
+        prompt();
+    }
+    else if (cmd == "trace") {
+        std::string_view action = next_token(rest);
+        std::string argument(next_token(rest));
+
+        if (action == "start") {
+            std::uint32_t sample_every = argument.empty() ? 1 : static_cast<std::uint32_t>(std::strtoul(argument.c_str(), nullptr, 10));
+            trace::start(sample_every);
+            std::cout << "Tracing started" << (WS_TRACE_ENABLED ? "" : " (trace points compiled out)") << ".\n";
+        } else if (action == "stop" && !argument.empty()) {
+            trace::stop();
+            if (trace::write_chrome_json(argument)) {
+                std::cout << "Trace written to " << argument << "\n";
+            } else {
+                std::cout << "Failed to write trace to " << argument << "\n";
+            }
+        } else {
+            std::cout << "Usage: trace start [sample_every] | trace stop <file>\n";
+        }
+        prompt();
+    }
+    else if (cmd == "stats") {
+        print_stats();
+        prompt();
+    }
     else if (cmd == "exit" || cmd == "quit") {
+        if (batch_mode_) {
+            finish_batch();
+            return;
+        }
         if (client_->is_connected()) {
             std::cout << "Closing active connection before exiting...\n";
             client_->close();
             std::this_thread::sleep_for(std::chrono::seconds(1));
         }
         std::cout << "Exiting application.\n";
-        std::cout << "> " << std::flush; 
+        prompt();
         exit(0);
     } 
     else {
         std::cout << "Unknown command: " << cmd << "\n";
         print_help();
-        std::cout << "> " << std::flush;
+        prompt();
     }
 }
 
 void CommandHandler::run_command_loop() {
-    print_help();
-    std::cout << "> " << std::flush;
+    if (interactive_) print_help();
+    prompt();
 
     while (true) {
         std::string command;
@@ -135,12 +224,170 @@ void CommandHandler::run_command_loop() {
     }
 }
 
+void CommandHandler::set_conflation(std::shared_ptr<ConflatingDispatcher> conflator) {
+    conflator_ = conflator;
+
+    // message_callback_ is read on the I/O thread, so swap it there. The old
+    // dispatcher is destroyed (and its worker joined) once no callback holds it.
+    MessageCallback callback = print_message;
+    if (conflator) {
+        callback = [conflator](const std::string& message) { conflator->push(message); };
+    }
+    net::post(ioc_, [client = client_, callback = std::move(callback)]() mutable {
+        client->set_message_callback(std::move(callback));
+    });
+}
+
+void CommandHandler::print_stats() const {
+    MemoryStats memory = WebSocketClient::memory_stats();
+    std::cout << "Memory: open_connections=" << memory.open_connections
+              << " read_buffer_bytes=" << memory.read_buffer_bytes
+              << " write_queue_bytes=" << memory.write_queue_bytes << "\n";
+
+    if (!conflator_) {
+        std::cout << "Conflation: off\n";
+        return;
+    }
+
+    ConflationStats stats = conflator_->stats();
+    std::cout << "Conflation: received=" << stats.received
+              << " delivered=" << stats.delivered
+              << " conflated=" << stats.conflated
+              << " dropped=" << stats.dropped
+              << " evicted=" << stats.evicted
+              << " unkeyed_dropped=" << stats.unkeyed_dropped
+              << " pending_keys=" << stats.pending_keys
+              << " ratio=" << stats.ratio() << "\n";
+}
+
+void CommandHandler::wait_for_signal() {
+    signals_.async_wait(beast::bind_front_handler(&CommandHandler::on_signal, this));
+}
+
+void CommandHandler::on_signal(beast::error_code ec, int signal_number) {
+    boost::ignore_unused(signal_number);
+    if (ec) return;
+
+    if (!trace::enabled()) {
+        trace::start();
+        std::cout << "Tracing started (SIGUSR1).\n";
+    } else {
+        trace::stop();
+        std::string path = "websocket_client-trace-" + std::to_string(::getpid()) + ".json";
+        if (trace::write_chrome_json(path)) {
+            std::cout << "Trace written to " << path << "\n";
+        } else {
+            std::cout << "Failed to write trace to " << path << "\n";
+        }
+    }
+    wait_for_signal();
+}
+
+void CommandHandler::start_batch_mode() {
+    batch_mode_ = true;
+
+    beast::error_code ec;
+    int fd = ::dup(input_fd_);
+    if (fd >= 0) input_.assign(fd, ec);
+    if (fd < 0 || ec) {
+        // Regular files cannot be registered with the reactor; reading them
+        // never blocks for long, so fall back to plain reads, one line per handler.
+        if (fd >= 0) ::close(fd);
+        sync_input_ = true;
+    }
+    do_read_input();
+}
+
+bool CommandHandler::has_connection() const {
+    // In batch mode the client queues sends and defers a close issued while
+    // the handshake is in flight, so a script can `connect`, `send` and
+    // `close` without waiting.
+    return client_->is_connected() || (batch_mode_ && client_->is_connecting());
+}
+
+void CommandHandler::do_read_input() {
+    if (sync_input_) {
+        net::post(ioc_, [this]() { read_input_sync(); });
+        return;
+    }
+    net::async_read_until(input_, input_buffer_, '\n', beast::bind_front_handler(&CommandHandler::on_read_input, this));
+}
+
+void CommandHandler::on_read_input(beast::error_code ec, std::size_t bytes_transferred) {
+    if (input_done_) return;
+
+    if (ec && ec != net::error::eof) {
+        std::cerr << "Error in read input: " << ec.message() << std::endl;
+        finish_batch();
+        return;
+    }
+
+    std::string line;
+    std::istream is(&input_buffer_);
+    if (!ec) {
+        // One command per handler so queued writes can interleave with parsing.
+        line.resize(bytes_transferred - 1);
+        is.read(&line[0], static_cast<std::streamsize>(line.size()));
+        input_buffer_.consume(1);
+        process_command(line);
+        if (!input_done_) do_read_input();
+        return;
+    }
+
+    // EOF: run a trailing command that had no newline, then shut down.
+    std::getline(is, line);
+    if (!line.empty()) process_command(line);
+    finish_batch();
+}
+
+void CommandHandler::read_input_sync() {
+    if (input_done_) return;
+
+    // Fill input_buffer_ up to the next newline, then hand the line to the
+    // same completion handler the async path uses.
+    std::size_t scanned = 0;
+    while (true) {
+        auto data = input_buffer_.data();
+        std::string_view buffered(static_cast<const char*>(data.data()), data.size());
+        auto newline = buffered.find('\n', scanned);
+        if (newline != std::string_view::npos) {
+            on_read_input({}, newline + 1);
+            return;
+        }
+        scanned = buffered.size();
+
+        auto space = input_buffer_.prepare(4096);
+        ssize_t n = ::read(input_fd_, space.data(), space.size());
+        if (n <= 0) {
+            on_read_input(n == 0 ? beast::error_code(net::error::eof)
+                                 : beast::error_code(errno, boost::system::system_category()), 0);
+            return;
+        }
+        input_buffer_.commit(static_cast<std::size_t>(n));
+    }
+}
+
+void CommandHandler::finish_batch() {
+    if (input_done_) return;
+    input_done_ = true;
+
+    beast::error_code ec;
+    input_.close(ec);
+    signals_.cancel(ec);
+    // Drains queued sends before closing; io_context then runs out of work.
+    client_->close();
+}
+
 void CommandHandler::print_help() const {
     std::cout << "Available commands:\n"
               << "  connect <host> <port>  - Connect to a WebSocket server\n"
               << "  send <message>         - Send a text message to the server\n"
               << "  sendbin <message>      - Send a binary message to the server\n"
               << "  close                  - Close the connection\n"
+              << "  conflate <field>|off   - Deliver only the latest message per JSON field value\n"
+              << "  stats                  - Show delivery and memory statistics\n"
+              << "  trace start [N]        - Record trace events (keep 1 in N reads/writes/callbacks)\n"
+              << "  trace stop <file>      - Stop tracing and write Chrome trace JSON\n"
               << "  help                   - Show this help message\n"
               << "  exit                   - Exit the application\n";
 }
\ No newline at end of file
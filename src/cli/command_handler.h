@@ -2,21 +2,52 @@
 #define COMMAND_HANDLER_H
 
 #include "../websocket/websocket_client.h"
+#include "../websocket/conflating_dispatcher.h"
 #include <memory>
 #include <boost/asio.hpp>
+#include <boost/asio/posix/stream_descriptor.hpp>
+#include <boost/asio/signal_set.hpp>
+#include <unistd.h>
 
 namespace net = boost::asio;
 
 class CommandHandler {
 public:
-    CommandHandler(std::shared_ptr<WebSocketClient> client, net::io_context& ioc);
+    // Commands are read from `input_fd` (stdin unless a test substitutes a pipe).
+    CommandHandler(std::shared_ptr<WebSocketClient> client, net::io_context& ioc, int input_fd = STDIN_FILENO);
     void process_command(const std::string& command);
     void run_command_loop();
+    // Reads commands from stdin asynchronously on the io_context instead of
+    // blocking the caller. The caller drives the io_context; it runs out of
+    // work once input hits EOF (or `exit`) and pending writes are flushed.
+    void start_batch_mode();
     void print_help() const;
+    bool is_interactive() const;
 
 private:
+    void prompt() const;
+    bool has_connection() const;
+    void do_read_input();
+    void on_read_input(beast::error_code ec, std::size_t bytes_transferred);
+    void read_input_sync();
+    void finish_batch();
+    void set_conflation(std::shared_ptr<ConflatingDispatcher> conflator);
+    void print_stats() const;
+    void wait_for_signal();
+    void on_signal(beast::error_code ec, int signal_number);
+
     std::shared_ptr<WebSocketClient> client_;
-    [[maybe_unused]] net::io_context& ioc_; 
+    std::shared_ptr<ConflatingDispatcher> conflator_;
+    net::io_context& ioc_;
+    const int input_fd_;
+    net::posix::stream_descriptor input_;
+    net::streambuf input_buffer_;
+    // SIGUSR1 toggles tracing; the second signal dumps the trace.
+    net::signal_set signals_;
+    bool interactive_;
+    bool batch_mode_ = false;
+    bool input_done_ = false;
+    bool sync_input_ = false;
 };
 
-#endif
\ No newline at end of file
+#endif
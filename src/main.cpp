@@ -53,7 +53,16 @@ int main(int argc, char** argv) {
             }
         } else {
             std::cout << "Usage: " << argv[0] << " <host> <port> [message]\n";
-            std::cout << "Starting in interactive mode...\n";
+            if (handler.is_interactive()) std::cout << "Starting in interactive mode...\n";
+        }
+
+        if (!handler.is_interactive()) {
+            // Piped/scripted input: read commands on the io_context and run it
+            // here. It returns once input ends and queued writes are flushed.
+            handler.start_batch_mode();
+            work_guard.reset();
+            ioc.run();
+            return 0;
         }
 
         std::thread ioc_thread([&ioc]() {
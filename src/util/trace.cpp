@@ -0,0 +1,226 @@
+#include "trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace trace {
+
+namespace detail {
+std::atomic<bool> g_enabled{false};
+std::atomic<std::uint32_t> g_sample_every{1};
+}
+
+namespace {
+
+struct Event {
+    const char* name;
+    const char* category;
+    std::uint64_t ts;   // ticks
+    std::uint64_t arg;  // duration in ticks for 'X', id for 'b'/'e'
+    char phase;
+};
+
+// An Event as stored in the ring. Fields are relaxed atomics because a dump
+// may copy a slot while its owner overwrites it; such copies are discarded.
+struct Slot {
+    std::atomic<const char*> name;
+    std::atomic<const char*> category;
+    std::atomic<std::uint64_t> ts;
+    std::atomic<std::uint64_t> arg;
+    std::atomic<char> phase;
+};
+
+struct ThreadBuffer {
+    explicit ThreadBuffer(std::uint32_t id) : tid(id) {}
+
+    std::unique_ptr<Slot[]> slots{new Slot[kEventsPerThread]};
+    // Both written only by the owning thread, seqlock style: `started` is
+    // bumped (and fenced) before a slot is overwritten, `head` released once
+    // it is complete. A dump copies below head, then rejects any slot that
+    // `started` shows may have been overwritten meanwhile.
+    std::atomic<std::uint64_t> started{0};
+    std::atomic<std::uint64_t> head{0};
+    const std::uint32_t tid;
+};
+
+struct Registry {
+    std::mutex mutex;
+    // Buffers outlive their threads so a dump still covers exited threads.
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    // Tick and steady_clock readings at both ends of the session, used to
+    // calibrate ticks to nanoseconds.
+    std::atomic<std::uint64_t> start_ticks{0};
+    std::atomic<std::uint64_t> start_ns{0};
+    std::atomic<std::uint64_t> end_ticks{0};
+    std::atomic<std::uint64_t> end_ns{0};
+};
+
+Registry& registry() {
+    static Registry instance;
+    return instance;
+}
+
+ThreadBuffer& thread_buffer() {
+    thread_local ThreadBuffer* buffer = nullptr;
+    if (!buffer) {
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        reg.buffers.push_back(std::make_unique<ThreadBuffer>(static_cast<std::uint32_t>(reg.buffers.size() + 1)));
+        buffer = reg.buffers.back().get();
+    }
+    return *buffer;
+}
+
+std::uint64_t steady_ns() {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void record(const char* name, const char* category, char phase, std::uint64_t ts, std::uint64_t arg) {
+    ThreadBuffer& buffer = thread_buffer();
+    const std::uint64_t head = buffer.head.load(std::memory_order_relaxed);
+    buffer.started.store(head + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    Slot& slot = buffer.slots[head & (kEventsPerThread - 1)];
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.category.store(category, std::memory_order_relaxed);
+    slot.ts.store(ts, std::memory_order_relaxed);
+    slot.arg.store(arg, std::memory_order_relaxed);
+    slot.phase.store(phase, std::memory_order_relaxed);
+    buffer.head.store(head + 1, std::memory_order_release);
+}
+
+}
+
+static_assert((kEventsPerThread & (kEventsPerThread - 1)) == 0, "ring size must be a power of two");
+
+std::uint64_t now() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    std::uint64_t ticks;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    return steady_ns();
+#endif
+}
+
+void start(std::uint32_t sample_every) {
+    Registry& reg = registry();
+    detail::g_sample_every.store(sample_every ? sample_every : 1, std::memory_order_relaxed);
+    reg.end_ticks.store(0, std::memory_order_relaxed);
+    reg.start_ns.store(steady_ns(), std::memory_order_relaxed);
+    reg.start_ticks.store(now(), std::memory_order_relaxed);
+    detail::g_enabled.store(true, std::memory_order_release);
+}
+
+void stop() {
+    Registry& reg = registry();
+    detail::g_enabled.store(false, std::memory_order_release);
+    reg.end_ns.store(steady_ns(), std::memory_order_relaxed);
+    reg.end_ticks.store(now(), std::memory_order_relaxed);
+}
+
+void begin(const char* name, const char* category, const void* id) {
+    record(name, category, 'b', now(), reinterpret_cast<std::uintptr_t>(id));
+}
+
+void end(const char* name, const char* category, const void* id) {
+    record(name, category, 'e', now(), reinterpret_cast<std::uintptr_t>(id));
+}
+
+void complete(const char* name, const char* category, std::uint64_t start) {
+    record(name, category, 'X', start, now() - start);
+}
+
+Scope::Scope(const char* name, const char* category) : name_(name), category_(category) {
+    if (!enabled()) return;
+    thread_local std::uint64_t scopes = 0;
+    if (sampled(scopes++)) start_ = now();
+}
+
+Scope::~Scope() {
+    if (start_) complete(name_, category_, start_);
+}
+
+bool write_chrome_json(const std::string& path) {
+    std::ofstream out(path);
+    if (!out) return false;
+
+    Registry& reg = registry();
+    const std::uint64_t session_start = reg.start_ticks.load(std::memory_order_relaxed);
+    std::uint64_t session_end = reg.end_ticks.load(std::memory_order_relaxed);
+    std::uint64_t end_ns = reg.end_ns.load(std::memory_order_relaxed);
+    if (session_end == 0) {
+        end_ns = steady_ns();
+        session_end = now();
+    }
+    const std::uint64_t elapsed_ns = end_ns - reg.start_ns.load(std::memory_order_relaxed);
+    const std::uint64_t elapsed_ticks = session_end - session_start;
+    const double us_per_tick = elapsed_ticks ? static_cast<double>(elapsed_ns) / 1000.0 / static_cast<double>(elapsed_ticks) : 0.0;
+    const int pid = static_cast<int>(::getpid());
+
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    char line[256];
+
+    std::vector<Event> snapshot;
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    for (const auto& buffer : reg.buffers) {
+        const std::uint64_t head = buffer->head.load(std::memory_order_acquire);
+        const std::uint64_t tail = head > kEventsPerThread ? head - kEventsPerThread : 0;
+        snapshot.clear();
+        for (std::uint64_t i = tail; i < head; ++i) {
+            const Slot& slot = buffer->slots[i & (kEventsPerThread - 1)];
+            snapshot.push_back(Event{slot.name.load(std::memory_order_relaxed),
+                                     slot.category.load(std::memory_order_relaxed),
+                                     slot.ts.load(std::memory_order_relaxed),
+                                     slot.arg.load(std::memory_order_relaxed),
+                                     slot.phase.load(std::memory_order_relaxed)});
+        }
+
+        // The owner may have kept recording during the copy (a scope closing
+        // just after stop(), or a dump without stop()). Write number w reuses
+        // the slot of event w - kEventsPerThread, so every event below
+        // started - kEventsPerThread may have been copied torn; drop those.
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const std::uint64_t started = buffer->started.load(std::memory_order_relaxed);
+        const std::uint64_t first_intact = started > kEventsPerThread ? started - kEventsPerThread : 0;
+        const std::size_t skip = first_intact > tail ? std::min<std::uint64_t>(first_intact - tail, snapshot.size()) : 0;
+
+        for (std::size_t k = skip; k < snapshot.size(); ++k) {
+            const Event& e = snapshot[k];
+            if (e.ts < session_start || e.ts > session_end) continue;
+
+            // Chrome expects microseconds; keep nanosecond precision as decimals.
+            const double ts_us = static_cast<double>(e.ts - session_start) * us_per_tick;
+            if (e.phase == 'X') {
+                std::snprintf(line, sizeof(line),
+                              "%s\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%u}",
+                              first ? "" : ",", e.name, e.category, ts_us,
+                              static_cast<double>(e.arg) * us_per_tick, pid, buffer->tid);
+            } else {
+                std::snprintf(line, sizeof(line),
+                              "%s\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,\"id\":\"0x%llx\",\"pid\":%d,\"tid\":%u}",
+                              first ? "" : ",", e.name, e.category, e.phase, ts_us,
+                              static_cast<unsigned long long>(e.arg), pid, buffer->tid);
+            }
+            out << line;
+            first = false;
+        }
+    }
+    out << "\n]}\n";
+    return static_cast<bool>(out);
+}
+
+}
@@ -0,0 +1,88 @@
+#ifndef WEBSOCKET_CLIENT_TRACE_H
+#define WEBSOCKET_CLIENT_TRACE_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+// Build with WS_TRACE_ENABLED=0 to compile every WS_TRACE_* macro away.
+#ifndef WS_TRACE_ENABLED
+#define WS_TRACE_ENABLED 1
+#endif
+
+namespace trace {
+
+// Each thread records into its own fixed-size ring; recording never takes a
+// lock. When a ring wraps, the oldest events are overwritten.
+constexpr std::size_t kEventsPerThread = 1 << 16;
+
+namespace detail {
+extern std::atomic<bool> g_enabled;
+extern std::atomic<std::uint32_t> g_sample_every;
+}
+
+inline bool enabled() {
+    return detail::g_enabled.load(std::memory_order_relaxed);
+}
+
+// True for one in every `sample_every` values of `seq`.
+inline bool sampled(std::uint64_t seq) {
+    return seq % detail::g_sample_every.load(std::memory_order_relaxed) == 0;
+}
+
+// Starts a session; high-frequency events are kept 1 in `sample_every`.
+void start(std::uint32_t sample_every = 1);
+void stop();
+
+// Writes the current session as Chrome trace JSON (chrome://tracing, Perfetto).
+// Safe to call from any thread while others record; events overwritten
+// during the dump are left out. Call after stop() for a consistent snapshot.
+bool write_chrome_json(const std::string& path);
+
+// Raw timestamp in CPU ticks (TSC / virtual counter, steady_clock elsewhere);
+// converted to wall time when the trace is written.
+std::uint64_t now();
+
+// Async span bounds, paired by category and id.
+void begin(const char* name, const char* category, const void* id);
+void end(const char* name, const char* category, const void* id);
+// A span measured on a single thread.
+void complete(const char* name, const char* category, std::uint64_t start);
+
+class Scope {
+public:
+    Scope(const char* name, const char* category);
+    ~Scope();
+
+private:
+    const char* name_;
+    const char* category_;
+    std::uint64_t start_ = 0;
+};
+
+}
+
+#define WS_TRACE_CONCAT_INNER(a, b) a##b
+#define WS_TRACE_CONCAT(a, b) WS_TRACE_CONCAT_INNER(a, b)
+
+#if WS_TRACE_ENABLED
+#define WS_TRACE_SCOPE(name, category) \
+    ::trace::Scope WS_TRACE_CONCAT(ws_trace_scope_, __LINE__)(name, category)
+#define WS_TRACE_BEGIN(name, category, id) \
+    do { if (::trace::enabled()) ::trace::begin(name, category, id); } while (0)
+#define WS_TRACE_END(name, category, id) \
+    do { if (::trace::enabled()) ::trace::end(name, category, id); } while (0)
+// Sampled spans decide on `seq` so the begin and end of a span agree.
+#define WS_TRACE_BEGIN_SAMPLED(name, category, id, seq) \
+    do { if (::trace::enabled() && ::trace::sampled(seq)) ::trace::begin(name, category, id); } while (0)
+#define WS_TRACE_END_SAMPLED(name, category, id, seq) \
+    do { if (::trace::enabled() && ::trace::sampled(seq)) ::trace::end(name, category, id); } while (0)
+#else
+#define WS_TRACE_SCOPE(name, category) ((void)0)
+#define WS_TRACE_BEGIN(name, category, id) ((void)0)
+#define WS_TRACE_END(name, category, id) ((void)0)
+#define WS_TRACE_BEGIN_SAMPLED(name, category, id, seq) ((void)0)
+#define WS_TRACE_END_SAMPLED(name, category, id, seq) ((void)0)
+#endif
+
+#endif
@@ -5,51 +5,145 @@
 #include <sstream>
 #include <iomanip>
 #include <random>
+#include <cerrno>
+#include <cstring>
 #include <openssl/sha.h>
 #include <stdexcept>  
 #include <atomic>   
+#if defined(__linux__)
+#include <sys/random.h>
+#else
+#include <unistd.h>
+#endif
 
 namespace util {
 
+static const char base64_chars[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+    "abcdefghijklmnopqrstuvwxyz"
+    "0123456789+/";
+
+// Encodes `size` bytes into `out`, which must hold 4 * ceil(size / 3) chars
+static void base64EncodeTo(const unsigned char* data, std::size_t size, char* out) {
+    std::size_t i = 0;
+    for (; i + 3 <= size; i += 3) {
+        std::uint32_t n = (std::uint32_t(data[i]) << 16) | (std::uint32_t(data[i + 1]) << 8) | data[i + 2];
+        *out++ = base64_chars[(n >> 18) & 0x3f];
+        *out++ = base64_chars[(n >> 12) & 0x3f];
+        *out++ = base64_chars[(n >> 6) & 0x3f];
+        *out++ = base64_chars[n & 0x3f];
+    }
+    if (i < size) {
+        std::uint32_t n = std::uint32_t(data[i]) << 16;
+        if (i + 1 < size) n |= std::uint32_t(data[i + 1]) << 8;
+        *out++ = base64_chars[(n >> 18) & 0x3f];
+        *out++ = base64_chars[(n >> 12) & 0x3f];
+        *out++ = (i + 1 < size) ? base64_chars[(n >> 6) & 0x3f] : '=';
+        *out++ = '=';
+    }
+}
+
+static bool isSpace(char c) {
+    return std::isspace(static_cast<unsigned char>(c)) != 0;
+}
+
+std::string_view trimView(std::string_view str) {
+    std::size_t start = 0, end = str.size();
+    while (start < end && isSpace(str[start])) ++start;
+    while (end > start && isSpace(str[end - 1])) --end;
+    return str.substr(start, end - start);
+}
+
+std::vector<std::string_view> splitView(std::string_view str, char delimiter) {
+    // Same semantics as std::getline: a trailing delimiter yields no empty token.
+    std::vector<std::string_view> tokens;
+    std::size_t start = 0;
+    while (start < str.size()) {
+        std::size_t end = str.find(delimiter, start);
+        if (end == std::string_view::npos) end = str.size();
+        tokens.push_back(str.substr(start, end - start));
+        start = end + 1;
+    }
+    return tokens;
+}
+
 std::string trim(const std::string& str) {
-    auto start = std::find_if_not(str.begin(), str.end(), ::isspace);
-    auto end = std::find_if_not(str.rbegin(), str.rend(), ::isspace).base();
-    return (start < end) ? std::string(start, end) : std::string();
+    return std::string(trimView(str));
 }
 
 std::vector<std::string> split(const std::string& str, char delimiter) {
     std::vector<std::string> tokens;
-    std::stringstream ss(str);
-    std::string token;
-
-    while (std::getline(ss, token, delimiter)) {
-        tokens.push_back(std::move(token));
+    for (std::string_view token : splitView(str, delimiter)) {
+        tokens.emplace_back(token);
     }
-
     return tokens;
 }
 
-std::string generateWebSocketKey() {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_int_distribution<unsigned char> dis(0, 255);
+static bool fillRandom(unsigned char* out, std::size_t size) {
+#if defined(__linux__)
+    while (size > 0) {
+        ssize_t n = ::getrandom(out, size, 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        out += n;
+        size -= static_cast<std::size_t>(n);
+    }
+    return true;
+#else
+    return ::getentropy(out, size) == 0;
+#endif
+}
 
-    std::string key(16, '\0');
-    for (auto& byte : key) {
-        byte = dis(gen);
+std::string generateWebSocketKey() {
+    // Random bytes are drawn from the kernel in blocks and handed out 16 at a
+    // time, so most calls make no syscall at all.
+    struct RandomPool {
+        unsigned char bytes[256];
+        std::size_t used = sizeof(bytes);
+    };
+    thread_local RandomPool pool;
+
+    constexpr std::size_t kKeyBytes = 16;
+    if (pool.used + kKeyBytes > sizeof(pool.bytes)) {
+        if (!fillRandom(pool.bytes, sizeof(pool.bytes))) {
+            std::random_device rd;
+            for (auto& byte : pool.bytes) byte = static_cast<unsigned char>(rd());
+        }
+        pool.used = 0;
     }
 
-    return base64Encode(key);
+    std::string key(24, '\0');
+    base64EncodeTo(pool.bytes + pool.used, kKeyBytes, &key[0]);
+    // Don't leave handed-out key material lying around in the pool.
+    std::memset(pool.bytes + pool.used, 0, kKeyBytes);
+    pool.used += kKeyBytes;
+    return key;
 }
 
-std::string computeAcceptKey(const std::string& key) {
-    const std::string magic = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
-    std::string combined = key + magic;
-
+void computeAcceptKey(std::string_view key, char (&out)[kAcceptKeySize]) {
+    static constexpr std::string_view magic = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
     unsigned char hash[SHA_DIGEST_LENGTH];
-    SHA1(reinterpret_cast<const unsigned char*>(combined.c_str()), combined.size(), hash);
 
-    return base64Encode(std::string(reinterpret_cast<char*>(hash), SHA_DIGEST_LENGTH));
+    // Client keys are 24 chars; anything that doesn't fit on the stack takes the slow path.
+    unsigned char combined[128];
+    if (key.size() + magic.size() <= sizeof(combined)) {
+        std::memcpy(combined, key.data(), key.size());
+        std::memcpy(combined + key.size(), magic.data(), magic.size());
+        SHA1(combined, key.size() + magic.size(), hash);
+    } else {
+        std::string joined = std::string(key) + std::string(magic);
+        SHA1(reinterpret_cast<const unsigned char*>(joined.data()), joined.size(), hash);
+    }
+
+    base64EncodeTo(hash, SHA_DIGEST_LENGTH, out);
+}
+
+std::string computeAcceptKey(const std::string& key) {
+    char out[kAcceptKeySize];
+    computeAcceptKey(key, out);
+    return std::string(out, kAcceptKeySize);
 }
 
 static std::atomic<LogLevel> currentLogLevel{LogLevel::LOG_INFO};
@@ -72,43 +166,9 @@ void log(LogLevel level, const std::string& message) {
     std::cout << prefix << message << std::endl;
 }
 
-static const std::string base64_chars = 
-    "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
-    "abcdefghijklmnopqrstuvwxyz"
-    "0123456789+/";
-
 std::string base64Encode(const std::string& data) {
-    std::string ret;
-    int i = 0;
-    unsigned char char_array_3[3];
-    unsigned char char_array_4[4];
-
-    for (char c : data) {
-        char_array_3[i++] = c;
-        if (i == 3) {
-            char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-            char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-            char_array_4[2] = ((char_array_3[1] & 0x0f) << 2) + ((char_array_3[2] & 0xc0) >> 6);
-            char_array_4[3] = char_array_3[2] & 0x3f;
-
-            for (int j = 0; j < 4; j++) {
-                ret += base64_chars[char_array_4[j]];
-            }
-            i = 0;
-        }
-    }
-
-    if (i) {
-        for (int j = i; j < 3; j++) char_array_3[j] = '\0';
-
-        char_array_4[0] = (char_array_3[0] & 0xfc) >> 2;
-        char_array_4[1] = ((char_array_3[0] & 0x03) << 4) + ((char_array_3[1] & 0xf0) >> 4);
-        char_array_4[2] = ((char_array_3[1] & 0x0f) << 2);
-
-        for (int j = 0; j < i + 1; j++) ret += base64_chars[char_array_4[j]];
-        while (i++ < 3) ret += '=';
-    }
-
+    std::string ret((data.size() + 2) / 3 * 4, '\0');
+    base64EncodeTo(reinterpret_cast<const unsigned char*>(data.data()), data.size(), &ret[0]);
     return ret;
 }
 
@@ -118,13 +178,14 @@ std::string base64Decode(const std::string& encoded_data) {
     }
 
     std::string ret;
+    ret.reserve(encoded_data.size() / 4 * 3);
     unsigned char char_array_4[4], char_array_3[3];
     int i = 0;
 
     for (char c : encoded_data) {
         if (c == '=') break;
 
-        char_array_4[i++] = static_cast<unsigned char>(base64_chars.find(c));
+        char_array_4[i++] = static_cast<unsigned char>(std::string_view(base64_chars).find(c));
         if (i == 4) {
             char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
             char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
@@ -135,15 +196,83 @@ std::string base64Decode(const std::string& encoded_data) {
         }
     }
 
-    if (i) {
-        for (int j = 0; j < i; j++) char_array_4[j] = static_cast<unsigned char>(base64_chars.find(char_array_4[j]));
+    // A padded final quantum carries 2 or 3 sextets, i.e. 1 or 2 bytes; its
+    // sextets were already mapped in the loop above.
+    if (i > 1) {
         char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-        ret.append(reinterpret_cast<char*>(char_array_3), 1);
+        char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + (i > 2 ? (char_array_4[2] & 0x3c) >> 2 : 0);
+        ret.append(reinterpret_cast<char*>(char_array_3), i - 1);
     }
 
     return ret;
 }
 
+static const char* const kJsonWhitespace = " \t\r\n";
+
+// Index of the quote closing the string that opens at text[open], or npos.
+static std::size_t jsonStringEnd(std::string_view text, std::size_t open) {
+    for (std::size_t i = open + 1; i < text.size(); ++i) {
+        if (text[i] == '\\') ++i;
+        else if (text[i] == '"') return i;
+    }
+    return std::string_view::npos;
+}
+
+// Index just past the JSON value starting at text[pos], or npos.
+static std::size_t jsonValueEnd(std::string_view text, std::size_t pos) {
+    if (text[pos] == '"') {
+        std::size_t end = jsonStringEnd(text, pos);
+        return end == std::string_view::npos ? end : end + 1;
+    }
+    if (text[pos] != '{' && text[pos] != '[') {
+        std::size_t end = text.find_first_of(",}] \t\r\n", pos);
+        return end == std::string_view::npos ? text.size() : end;
+    }
+
+    std::size_t depth = 0;
+    for (std::size_t i = pos; i < text.size(); ++i) {
+        char c = text[i];
+        if (c == '"') {
+            i = jsonStringEnd(text, i);
+            if (i == std::string_view::npos) return i;
+        } else if (c == '{' || c == '[') {
+            ++depth;
+        } else if ((c == '}' || c == ']') && --depth == 0) {
+            return i + 1;
+        }
+    }
+    return std::string_view::npos;
+}
+
+std::string_view jsonField(std::string_view json, std::string_view field) {
+    auto pos = json.find_first_not_of(kJsonWhitespace);
+    if (pos == std::string_view::npos || json[pos] != '{') return {};
+
+    // Walk the top-level members only, skipping over each value.
+    while (true) {
+        pos = json.find_first_not_of(kJsonWhitespace, pos + 1);
+        if (pos == std::string_view::npos || json[pos] != '"') return {};
+        auto key_end = jsonStringEnd(json, pos);
+        if (key_end == std::string_view::npos) return {};
+        std::string_view key = json.substr(pos + 1, key_end - pos - 1);
+
+        pos = json.find_first_not_of(kJsonWhitespace, key_end + 1);
+        if (pos == std::string_view::npos || json[pos] != ':') return {};
+        pos = json.find_first_not_of(kJsonWhitespace, pos + 1);
+        if (pos == std::string_view::npos) return {};
+
+        auto end = jsonValueEnd(json, pos);
+        if (end == std::string_view::npos) return {};
+        if (key == field) {
+            if (json[pos] == '"') return json.substr(pos + 1, end - pos - 2);
+            return json.substr(pos, end - pos);
+        }
+
+        pos = json.find_first_not_of(kJsonWhitespace, end);
+        if (pos == std::string_view::npos || json[pos] != ',') return {};
+    }
+}
+
 UrlParts parseWebSocketUrl(const std::string& url) {
     UrlParts parts{};
     const std::string ws_prefix = "ws://";
@@ -2,7 +2,9 @@
 #define WEBSOCKET_CLIENT_UTIL_H
 
 #include <string>
+#include <string_view>
 #include <vector>
+#include <cstddef>
 #include <cstdint>
 
 namespace util {
@@ -13,10 +15,21 @@ std::string trim(const std::string& str);
 // Split a string by a delimiter into a vector of substrings
 std::vector<std::string> split(const std::string& str, char delimiter);
 
+// Non-allocating variants; the returned views point into `str`
+std::string_view trimView(std::string_view str);
+std::vector<std::string_view> splitView(std::string_view str, char delimiter);
+
+// 16 random bytes from the OS CSPRNG, base64-encoded
 std::string generateWebSocketKey();
 
 std::string computeAcceptKey(const std::string& key);
 
+// Length of a Sec-WebSocket-Accept value (base64 of a SHA-1 digest)
+constexpr std::size_t kAcceptKeySize = 28;
+
+// Writes the accept key for `key` into `out` without allocating
+void computeAcceptKey(std::string_view key, char (&out)[kAcceptKeySize]);
+
 enum class LogLevel {
     LOG_DEBUG, 
     LOG_INFO,
@@ -32,6 +45,11 @@ std::string base64Encode(const std::string& data);
 
 std::string base64Decode(const std::string& data);
 
+// Value of the top-level "field" of a JSON object, without quotes if it is a
+// string; nested objects, arrays and string contents are skipped. Empty if
+// the field is absent or the input malformed. The view points into `json`.
+std::string_view jsonField(std::string_view json, std::string_view field);
+
 struct UrlParts {
     bool secure;         
     std::string host;    // Hostname (e.g., "example.com")
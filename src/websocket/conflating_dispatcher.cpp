@@ -0,0 +1,108 @@
+#include "conflating_dispatcher.h"
+#include "../util/util.h"
+#include <algorithm>
+
+ConflatingDispatcher::ConflatingDispatcher(KeyExtractor extractor, std::function<void(const std::string&)> consumer,
+                                           std::size_t max_keys, std::size_t max_unkeyed)
+    : extractor_(std::move(extractor)), consumer_(std::move(consumer)), max_keys_(max_keys),
+      max_unkeyed_(std::max<std::size_t>(max_unkeyed, 1)) {
+    worker_ = std::thread(&ConflatingDispatcher::run, this);
+}
+
+ConflatingDispatcher::~ConflatingDispatcher() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_one();
+    if (worker_.joinable()) worker_.join();
+}
+
+void ConflatingDispatcher::push(const std::string& message) {
+    std::string key = extractor_(message);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++stats_.received;
+
+        if (key.empty()) {
+            if (unkeyed_.size() >= max_unkeyed_) {
+                // The oldest unkeyed message owns the first null slot; at most
+                // max_keys keyed entries sit in front of it.
+                unkeyed_.pop_front();
+                dirty_.erase(std::find(dirty_.begin(), dirty_.end(), nullptr));
+                ++stats_.unkeyed_dropped;
+            }
+            unkeyed_.push_back(message);
+            dirty_.push_back(nullptr);
+        } else {
+            auto it = latest_.find(key);
+            const bool created = it == latest_.end();
+            if (created) {
+                if (latest_.size() >= max_keys_) {
+                    if (clean_.empty()) {
+                        ++stats_.dropped;
+                        return;
+                    }
+                    Entry* victim = clean_.front();
+                    clean_.pop_front();
+                    latest_.erase(*victim->key);
+                    ++stats_.evicted;
+                }
+                it = latest_.emplace(std::move(key), Entry{}).first;
+                it->second.key = &it->first;
+            }
+
+            // Only clean entries are erased, so Entry pointers in dirty_ stay
+            // valid; map nodes do not move on rehash.
+            Entry& entry = it->second;
+            entry.value.assign(message);
+            if (entry.dirty) {
+                ++stats_.conflated;
+                return;
+            }
+            if (!created) clean_.erase(entry.clean_pos);
+            entry.dirty = true;
+            dirty_.push_back(&entry);
+        }
+    }
+    cv_.notify_one();
+}
+
+ConflationStats ConflatingDispatcher::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ConflationStats stats = stats_;
+    stats.pending_keys = dirty_.size() - unkeyed_.size();
+    return stats;
+}
+
+void ConflatingDispatcher::run() {
+    std::string message;
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        cv_.wait(lock, [this]() { return stopping_ || !dirty_.empty(); });
+        if (stopping_) return;
+
+        Entry* entry = dirty_.front();
+        dirty_.pop_front();
+        if (entry) {
+            entry->dirty = false;
+            entry->clean_pos = clean_.insert(clean_.end(), entry);
+            // Swap rather than copy: the entry reuses our previous buffer.
+            message.swap(entry->value);
+        } else {
+            message.swap(unkeyed_.front());
+            unkeyed_.pop_front();
+        }
+        ++stats_.delivered;
+
+        lock.unlock();
+        consumer_(message);
+        lock.lock();
+    }
+}
+
+KeyExtractor ConflatingDispatcher::json_field(std::string field) {
+    return [field = std::move(field)](const std::string& message) {
+        return std::string(util::jsonField(message, field));
+    };
+}
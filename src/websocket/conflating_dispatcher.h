@@ -0,0 +1,83 @@
+#ifndef WEBSOCKET_CONFLATING_DISPATCHER_H
+#define WEBSOCKET_CONFLATING_DISPATCHER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+using KeyExtractor = std::function<std::string(const std::string&)>;
+
+struct ConflationStats {
+    std::uint64_t received = 0;   // messages pushed
+    std::uint64_t delivered = 0;  // messages handed to the consumer
+    std::uint64_t conflated = 0;  // messages overwritten before delivery
+    std::uint64_t dropped = 0;    // messages for new keys refused at max_keys
+    std::uint64_t evicted = 0;    // delivered keys forgotten to make room at max_keys
+    std::uint64_t unkeyed_dropped = 0;  // oldest unkeyed messages discarded at max_unkeyed
+    std::size_t pending_keys = 0;
+
+    // Messages accepted per message delivered; 1.0 means no conflation.
+    double ratio() const {
+        return delivered ? static_cast<double>(received - dropped - unkeyed_dropped) / delivered : 0.0;
+    }
+};
+
+// Sits between WebSocketClient::on_read and a slow consumer. Each message is
+// stored as the latest value for its key; a consumer thread delivers only the
+// newest version of every key that changed since it was last delivered.
+// Messages without a key (acks, errors) are never conflated and are delivered
+// in arrival order alongside the keyed ones; at most max_unkeyed of them wait,
+// and past that the oldest is discarded. Keyed state is bounded by max_keys
+// entries: at capacity the least recently delivered key is evicted, and a new
+// key is dropped only if every entry is still pending.
+class ConflatingDispatcher {
+public:
+    ConflatingDispatcher(KeyExtractor extractor, std::function<void(const std::string&)> consumer,
+                         std::size_t max_keys = 4096, std::size_t max_unkeyed = 1024);
+    ~ConflatingDispatcher();
+
+    ConflatingDispatcher(const ConflatingDispatcher&) = delete;
+    ConflatingDispatcher& operator=(const ConflatingDispatcher&) = delete;
+
+    // Called from the I/O thread; never blocks on the consumer.
+    void push(const std::string& message);
+    ConflationStats stats() const;
+
+    // Keys messages by a top-level JSON field (see util::jsonField).
+    static KeyExtractor json_field(std::string field);
+
+private:
+    struct Entry {
+        std::string value;
+        bool dirty = false;
+        const std::string* key = nullptr;
+        std::list<Entry*>::iterator clean_pos;  // valid while !dirty
+    };
+
+    void run();
+
+    KeyExtractor extractor_;
+    std::function<void(const std::string&)> consumer_;
+    const std::size_t max_keys_;
+    const std::size_t max_unkeyed_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::unordered_map<std::string, Entry> latest_;
+    // Delivery order; a null slot stands for the next unkeyed message.
+    std::deque<Entry*> dirty_;
+    std::deque<std::string> unkeyed_;
+    // Delivered entries, least recently delivered first: eviction candidates.
+    std::list<Entry*> clean_;
+    ConflationStats stats_;
+    bool stopping_ = false;
+    std::thread worker_;
+};
+
+#endif
@@ -0,0 +1,184 @@
+#include "feed_arbitrator.h"
+#include "../util/util.h"
+#include <algorithm>
+#include <charconv>
+#include <iterator>
+
+FeedArbitrator::FeedArbitrator(net::io_context& ioc, ssl::context& ctx, SequenceExtractor extractor,
+                               MessageCallback consumer, std::size_t reorder_window,
+                               std::chrono::milliseconds gap_timeout)
+    : ioc_(ioc), ctx_(ctx), extractor_(std::move(extractor)), consumer_(std::move(consumer)),
+      window_(std::max<std::size_t>(reorder_window, 1)), gap_timeout_(gap_timeout), gap_timer_(ioc),
+      seen_(window_ * 4) {
+}
+
+void FeedArbitrator::add_endpoint(const std::string& host, const std::string& port) {
+    auto client = std::make_shared<WebSocketClient>(ioc_, ctx_);
+    const std::size_t index = clients_.size();
+    std::weak_ptr<FeedArbitrator> weak = shared_from_this();
+    client->set_message_callback([weak, index](const std::string& message) {
+        if (auto self = weak.lock()) self->on_message(index, message);
+    });
+
+    clients_.push_back(std::move(client));
+    addresses_.emplace_back(host, port);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    EndpointStats endpoint;
+    endpoint.name = host + ":" + port;
+    stats_.endpoints.push_back(std::move(endpoint));
+}
+
+void FeedArbitrator::connect() {
+    for (std::size_t i = 0; i < clients_.size(); ++i) {
+        clients_[i]->connect(addresses_[i].first, addresses_[i].second);
+    }
+}
+
+void FeedArbitrator::send(const std::string& message) {
+    for (auto& client : clients_) {
+        client->send(message);
+    }
+}
+
+void FeedArbitrator::close() {
+    for (auto& client : clients_) {
+        client->close();
+    }
+}
+
+ArbitrationStats FeedArbitrator::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void FeedArbitrator::on_message(std::size_t endpoint, const std::string& message,
+                                std::chrono::steady_clock::time_point arrival) {
+    std::optional<std::uint64_t> sequence = extractor_(message);
+    std::vector<std::string> ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        EndpointStats& source = stats_.endpoints[endpoint];
+        ++source.received;
+        if (sequence) {
+            on_sequenced(source, *sequence, message, arrival, ready);
+        } else {
+            ++stats_.unsequenced;
+            ready.push_back(message);
+        }
+    }
+
+    for (const auto& m : ready) {
+        consumer_(m);
+    }
+}
+
+void FeedArbitrator::on_sequenced(EndpointStats& source, std::uint64_t seq, const std::string& message,
+                                  std::chrono::steady_clock::time_point arrival, std::vector<std::string>& ready) {
+    Seen& slot = seen_[seq % seen_.size()];
+    if (slot.valid && slot.sequence == seq) {
+        ++stats_.duplicates;
+        ++source.losses;
+        source.total_lag += arrival - slot.arrival;
+        return;
+    }
+    if (next_sequence_ && seq < *next_sequence_) {
+        // Already delivered (and evicted from seen_) or given up as a gap;
+        // still a loss, but there is no winner arrival left to measure against.
+        ++stats_.duplicates;
+        ++source.losses;
+        ++source.too_late;
+        return;
+    }
+
+    slot = {seq, arrival, true};
+    ++source.wins;
+    if (!next_sequence_) next_sequence_ = seq;
+
+    if (seq - *next_sequence_ >= window_) {
+        // Too far ahead to wait any longer: flush what we hold below the
+        // new window start and count everything missing as a gap.
+        const std::uint64_t window_start = seq - window_ + 1;
+        auto end = pending_.lower_bound(window_start);
+        std::uint64_t flushed = 0;
+        for (auto it = pending_.begin(); it != end; ++it, ++flushed) {
+            ready.push_back(std::move(it->second.message));
+        }
+        pending_.erase(pending_.begin(), end);
+        stats_.delivered += flushed;
+        stats_.gaps += (window_start - *next_sequence_) - flushed;
+        next_sequence_ = window_start;
+    }
+
+    if (seq == *next_sequence_) {
+        ready.push_back(message);
+        ++*next_sequence_;
+        ++stats_.delivered;
+    } else {
+        pending_.emplace(seq, Held{message, std::chrono::steady_clock::now()});
+        arm_gap_timer();
+    }
+    release_in_order(ready);
+}
+
+void FeedArbitrator::release_in_order(std::vector<std::string>& ready) {
+    while (!pending_.empty() && pending_.begin()->first == *next_sequence_) {
+        ready.push_back(std::move(pending_.begin()->second.message));
+        pending_.erase(pending_.begin());
+        ++*next_sequence_;
+        ++stats_.delivered;
+    }
+}
+
+void FeedArbitrator::arm_gap_timer() {
+    if (gap_timer_armed_ || pending_.empty()) return;
+
+    // The longest-held message sets the deadline; if it is released first,
+    // the timer fires early and re-arms for whatever is still held.
+    auto oldest = pending_.begin()->second.since;
+    for (const auto& entry : pending_) oldest = std::min(oldest, entry.second.since);
+    gap_timer_armed_ = true;
+    gap_timer_.expires_at(oldest + gap_timeout_);
+    gap_timer_.async_wait(beast::bind_front_handler(&FeedArbitrator::on_gap_timeout, shared_from_this()));
+}
+
+void FeedArbitrator::on_gap_timeout(beast::error_code ec) {
+    if (ec) return;
+
+    std::vector<std::string> ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        gap_timer_armed_ = false;
+
+        // Give up on every sequence missing below the last message that has
+        // been held for gap_timeout, and deliver up to it.
+        const auto expired = std::chrono::steady_clock::now() - gap_timeout_;
+        auto stop = pending_.begin();
+        for (auto it = pending_.begin(); it != pending_.end(); ++it) {
+            if (it->second.since <= expired) stop = std::next(it);
+        }
+        for (auto it = pending_.begin(); it != stop; ++it) {
+            stats_.gaps += it->first - *next_sequence_;
+            ready.push_back(std::move(it->second.message));
+            next_sequence_ = it->first + 1;
+            ++stats_.delivered;
+        }
+        pending_.erase(pending_.begin(), stop);
+        release_in_order(ready);
+        arm_gap_timer();
+    }
+
+    for (const auto& m : ready) {
+        consumer_(m);
+    }
+}
+
+SequenceExtractor FeedArbitrator::json_sequence(std::string field) {
+    return [field = std::move(field)](const std::string& message) -> std::optional<std::uint64_t> {
+        std::string_view text = util::jsonField(message, field);
+        std::uint64_t value = 0;
+        auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+        if (text.empty() || ec != std::errc() || end != text.data() + text.size()) return std::nullopt;
+        return value;
+    };
+}
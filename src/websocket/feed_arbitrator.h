@@ -0,0 +1,108 @@
+#ifndef WEBSOCKET_FEED_ARBITRATOR_H
+#define WEBSOCKET_FEED_ARBITRATOR_H
+
+#include "websocket_client.h"
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+using SequenceExtractor = std::function<std::optional<std::uint64_t>(const std::string&)>;
+
+struct EndpointStats {
+    std::string name;
+    std::uint64_t received = 0;
+    std::uint64_t wins = 0;         // sequences this endpoint delivered first
+    std::uint64_t losses = 0;       // sequences that arrived after another endpoint's copy
+    std::uint64_t too_late = 0;     // losses whose winner's arrival time was already forgotten
+    std::chrono::nanoseconds total_lag{0};  // summed delay behind the winner, over timed losses
+
+    double win_rate() const {
+        return (wins + losses) ? static_cast<double>(wins) / static_cast<double>(wins + losses) : 0.0;
+    }
+
+    std::chrono::nanoseconds mean_lag() const {
+        const std::uint64_t timed = losses - too_late;
+        return timed ? total_lag / static_cast<std::int64_t>(timed) : std::chrono::nanoseconds{0};
+    }
+};
+
+struct ArbitrationStats {
+    std::uint64_t delivered = 0;
+    std::uint64_t duplicates = 0;   // copies dropped because the sequence was already seen
+    std::uint64_t gaps = 0;         // sequences skipped because no endpoint supplied them in time
+    std::uint64_t unsequenced = 0;  // messages without a sequence, passed straight through
+    std::vector<EndpointStats> endpoints;
+};
+
+// Subscribes to the same feed over several endpoints and delivers whichever
+// copy of each sequence number arrives first, exactly once and in order.
+// Sequences arriving ahead of the next expected one wait in a reorder window.
+// The missing ones are declared a gap once a sequence lands beyond the window,
+// or once a held message has waited gap_timeout, whichever comes first.
+// Messages without a sequence (acks, heartbeats, errors) bypass arbitration
+// and reach the consumer from every endpoint.
+//
+// Message handling assumes the io_context is run by a single thread.
+class FeedArbitrator : public std::enable_shared_from_this<FeedArbitrator> {
+public:
+    FeedArbitrator(net::io_context& ioc, ssl::context& ctx, SequenceExtractor extractor,
+                   MessageCallback consumer, std::size_t reorder_window = 64,
+                   std::chrono::milliseconds gap_timeout = std::chrono::milliseconds(100));
+
+    void add_endpoint(const std::string& host, const std::string& port);
+    void connect();
+    // Sends to every endpoint, e.g. the subscription request.
+    void send(const std::string& message);
+    void close();
+    ArbitrationStats stats() const;
+
+    // Entry point for each endpoint's read callback; public for tests.
+    void on_message(std::size_t endpoint, const std::string& message,
+                    std::chrono::steady_clock::time_point arrival = std::chrono::steady_clock::now());
+
+    // Reads an unsigned integer from a top-level JSON field, e.g. "seq".
+    static SequenceExtractor json_sequence(std::string field);
+
+private:
+    struct Seen {
+        std::uint64_t sequence = 0;
+        std::chrono::steady_clock::time_point arrival;
+        bool valid = false;
+    };
+
+    struct Held {
+        std::string message;
+        std::chrono::steady_clock::time_point since;
+    };
+
+    void on_sequenced(EndpointStats& source, std::uint64_t seq, const std::string& message,
+                      std::chrono::steady_clock::time_point arrival, std::vector<std::string>& ready);
+    void release_in_order(std::vector<std::string>& ready);
+    void arm_gap_timer();
+    void on_gap_timeout(beast::error_code ec);
+
+    net::io_context& ioc_;
+    ssl::context& ctx_;
+    SequenceExtractor extractor_;
+    MessageCallback consumer_;
+    const std::size_t window_;
+    const std::chrono::milliseconds gap_timeout_;
+    net::steady_timer gap_timer_;
+    bool gap_timer_armed_ = false;
+
+    std::vector<std::shared_ptr<WebSocketClient>> clients_;
+    std::vector<std::pair<std::string, std::string>> addresses_;
+
+    mutable std::mutex mutex_;
+    std::optional<std::uint64_t> next_sequence_;
+    std::map<std::uint64_t, Held> pending_;
+    // First-arrival record per sequence, indexed by sequence % size.
+    std::vector<Seen> seen_;
+    ArbitrationStats stats_;
+};
+
+#endif
@@ -1,13 +1,22 @@
 #include "websocket_client.h"
+#include "../util/trace.h"
+#include <atomic>
 #include <iostream>
 
 void fail(beast::error_code ec, const char* what) {
     std::cerr << "Error in " << what << ": " << ec.message() << std::endl;
 }
 
+namespace {
+std::atomic<std::size_t> g_open_connections{0};
+std::atomic<std::size_t> g_read_buffer_bytes{0};
+std::atomic<std::size_t> g_write_queue_bytes{0};
+}
+
 WebSocketClient::WebSocketClient(net::io_context& ioc, ssl::context& ctx)
-    : resolver_(ioc), ws_(ioc, ctx), ctx_(ctx) {  
+    : resolver_(ioc), ws_(ioc, ctx), idle_timer_(ioc), ctx_(ctx) {  
     load_root_certificates(ctx_);
+    set_memory_budget(budget_);
     std::cout << "WebSocketClient constructed.\n";
 }
 
@@ -17,6 +26,9 @@ WebSocketClient::~WebSocketClient() {
         ws_.close(websocket::close_code::normal, ec);
         if (ec) fail(ec, "close during destruction");
     }
+    if (counted_open_) g_open_connections.fetch_sub(1, std::memory_order_relaxed);
+    g_read_buffer_bytes.fetch_sub(accounted_read_bytes_, std::memory_order_relaxed);
+    g_write_queue_bytes.fetch_sub(queued_bytes_, std::memory_order_relaxed);
 }
 
 void WebSocketClient::connect(const std::string& host, const std::string& port) {
@@ -26,6 +38,7 @@ void WebSocketClient::connect(const std::string& host, const std::string& port)
     }
     
     is_connecting_ = true;
+    is_closing_ = false;
     host_ = host;
     std::cout << "Resolving host: " << host_ << ":" << port << std::endl;
 
@@ -39,131 +52,318 @@ void WebSocketClient::connect(const std::string& host, const std::string& port)
     ws_.next_layer().set_verify_callback(ssl::host_name_verification(host));
 
     std::cout << "Starting async_resolve...\n";  
+    WS_TRACE_BEGIN("resolve", "connection", this);
     resolver_.async_resolve(host, port, beast::bind_front_handler(&WebSocketClient::on_resolve, shared_from_this()));
     std::cout << "async_resolve called.\n";  
 }
 
 void WebSocketClient::send(const std::string& message, bool is_binary) {
-    if (!is_connected_) {
-      std::cerr << "Cannot send message: Not connected." << std::endl;
-      return;
-    }
-    text_ = message;
-    ws_.binary(is_binary);
-    ws_.async_write(net::buffer(text_), beast::bind_front_handler(&WebSocketClient::on_write, shared_from_this()));
-  }
+    net::post(ws_.get_executor(), beast::bind_front_handler(&WebSocketClient::do_send, shared_from_this(), message, is_binary));
+}
 
 void WebSocketClient::close() {
-    if (!is_connected_) return;
-
-    std::cout << "Closing connection..." << std::endl;
-    is_connected_ = false;
-    ws_.async_close(websocket::close_code::normal, beast::bind_front_handler(&WebSocketClient::on_close, shared_from_this()));
+    net::post(ws_.get_executor(), beast::bind_front_handler(&WebSocketClient::do_close, shared_from_this()));
 }
 
 bool WebSocketClient::is_connected() const {
     return is_connected_;
 }
 
+bool WebSocketClient::is_connecting() const {
+    return is_connecting_;
+}
+
+std::size_t WebSocketClient::pending_writes() const {
+    return write_queue_.size();
+}
+
 void WebSocketClient::set_message_callback(MessageCallback callback) {
     message_callback_ = std::move(callback);
 }
 
+void WebSocketClient::set_memory_budget(const MemoryBudget& budget) {
+    if (is_connected_ || is_connecting_) {
+        std::cerr << "Cannot change memory budget on an open connection." << std::endl;
+        return;
+    }
+
+    budget_ = budget;
+    buffer_.max_size(budget_.read_chunk_bytes);
+    ws_.read_message_max(budget_.max_message_bytes);
+    ws_.write_buffer_bytes(budget_.write_buffer_bytes);
+}
+
+MemoryStats WebSocketClient::memory_stats() {
+    MemoryStats stats;
+    stats.open_connections = g_open_connections.load(std::memory_order_relaxed);
+    stats.read_buffer_bytes = g_read_buffer_bytes.load(std::memory_order_relaxed);
+    stats.write_queue_bytes = g_write_queue_bytes.load(std::memory_order_relaxed);
+    return stats;
+}
+
 void WebSocketClient::on_resolve(beast::error_code ec, tcp::resolver::results_type results) {
+    WS_TRACE_END("resolve", "connection", this);
     std::cout << "In on_resolve...\n";  
     if (ec) {
         is_connecting_ = false;
+        clear_write_queue();
         fail(ec, "resolve");
         return;
     }
 
     std::cout << "Resolved host. Found " << results.size() << " endpoints. Attempting connection..." << std::endl;
     beast::get_lowest_layer(ws_).expires_after(std::chrono::seconds(30));
+    WS_TRACE_BEGIN("connect", "connection", this);
     beast::get_lowest_layer(ws_).async_connect(results, beast::bind_front_handler(&WebSocketClient::on_connect, shared_from_this()));
 }
 
 void WebSocketClient::on_connect(beast::error_code ec, tcp::resolver::results_type::endpoint_type endpoint) {
+    WS_TRACE_END("connect", "connection", this);
     std::cout << "In on_connect...\n"; 
     if (ec) {
         is_connecting_ = false;
+        clear_write_queue();
         fail(ec, "connect");
         return;
     }
 
     std::cout << "Connected to: " << endpoint.address().to_string() << ":" << endpoint.port() << std::endl;
     host_ += ':' + std::to_string(endpoint.port());
+    // A message larger than one TLS record goes out as several segments;
+    // with Nagle on, the tail waits for the peer's delayed ACK (~40 ms).
+    beast::error_code option_ec;
+    beast::get_lowest_layer(ws_).socket().set_option(tcp::no_delay(true), option_ec);
 
     std::cout << "Performing SSL handshake..." << std::endl;
+    WS_TRACE_BEGIN("tls_handshake", "connection", this);
     ws_.next_layer().async_handshake(ssl::stream_base::client, beast::bind_front_handler(&WebSocketClient::on_ssl_handshake, shared_from_this()));
 }
 
 void WebSocketClient::on_ssl_handshake(beast::error_code ec) {
+    WS_TRACE_END("tls_handshake", "connection", this);
     if (ec) {
+        is_connecting_ = false;
+        clear_write_queue();
         fail(ec, "ssl_handshake");
         std::cerr << "SSL Error: " << ERR_reason_error_string(ERR_get_error()) << std::endl;
         return;
     }
 
     std::cout << "SSL handshake successful. Performing WebSocket handshake..." << std::endl;
+    WS_TRACE_BEGIN("ws_handshake", "connection", this);
     ws_.async_handshake(host_, "/", beast::bind_front_handler(&WebSocketClient::on_handshake, shared_from_this()));
 }
 
 void WebSocketClient::on_handshake(beast::error_code ec) {
+    WS_TRACE_END("ws_handshake", "connection", this);
     is_connecting_ = false;
     if (ec) {
+        clear_write_queue();
         fail(ec, "handshake");
         return;
     }
 
     std::cout << "Handshake successful. Connected!" << std::endl;
     is_connected_ = true;
+    counted_open_ = true;
+    g_open_connections.fetch_add(1, std::memory_order_relaxed);
 
     ws_.set_option(websocket::stream_base::timeout::suggested(beast::role_type::client));
     do_read();
+
+    // Flush anything queued while the handshake was in flight.
+    if (!write_queue_.empty()) {
+        do_write();
+    } else if (is_closing_) {
+        start_close();
+    }
+}
+
+void WebSocketClient::do_send(std::string message, bool is_binary) {
+    if ((!is_connected_ && !is_connecting_) || is_closing_) {
+        std::cerr << "Cannot send message: Not connected." << std::endl;
+        return;
+    }
+
+    queued_bytes_ += message.capacity();
+    g_write_queue_bytes.fetch_add(message.capacity(), std::memory_order_relaxed);
+    write_queue_.push_back({std::move(message), is_binary});
+    if (is_connected_ && !is_writing_) {
+        do_write();
+    }
+}
+
+void WebSocketClient::do_write() {
+    is_writing_ = true;
+    ws_.binary(write_queue_.front().is_binary);
+    WS_TRACE_BEGIN_SAMPLED("write", "write", this, ++writes_started_);
+    ws_.async_write(net::buffer(write_queue_.front().payload), beast::bind_front_handler(&WebSocketClient::on_write, shared_from_this()));
 }
 
 void WebSocketClient::on_write(beast::error_code ec, std::size_t bytes_transferred) {
+    WS_TRACE_END_SAMPLED("write", "write", this, writes_started_);
     boost::ignore_unused(bytes_transferred);
+    is_writing_ = false;
     if (ec) {
+        clear_write_queue();
         fail(ec, "write");
         return;
     }
-    std::cout << "Message sent successfully." << std::endl;
+    std::cout << "Message sent successfully.\n";
+
+    std::size_t released = write_queue_.front().payload.capacity();
+    queued_bytes_ -= released;
+    g_write_queue_bytes.fetch_sub(released, std::memory_order_relaxed);
+    write_queue_.pop_front();
+    if (!write_queue_.empty()) {
+        do_write();
+    } else if (is_closing_) {
+        start_close();
+    }
+}
+
+void WebSocketClient::do_close() {
+    if (is_closing_ || (!is_connected_ && !is_connecting_)) return;
+
+    std::cout << "Closing connection..." << std::endl;
+    is_closing_ = true;
+
+    // Pending writes are drained first; on_write/on_handshake finish the close.
+    if (is_connected_ && !is_writing_) {
+        start_close();
+    }
+}
+
+void WebSocketClient::start_close() {
+    is_connected_ = false;
+    WS_TRACE_BEGIN("close", "connection", this);
+    ws_.async_close(websocket::close_code::normal, beast::bind_front_handler(&WebSocketClient::on_close, shared_from_this()));
 }
 
 void WebSocketClient::do_read() {
     beast::get_lowest_layer(ws_).expires_after(std::chrono::seconds(30));
-    ws_.async_read(buffer_, beast::bind_front_handler(&WebSocketClient::on_read, shared_from_this()));
+    WS_TRACE_BEGIN_SAMPLED("read", "read", this, ++reads_started_);
+    // Read in bounded chunks and assemble the message ourselves: Beast keeps
+    // a pending read pinned to buffer_, but message_ can be shrunk while idle
+    // and buffer_ as soon as that read completes.
+    ws_.async_read_some(buffer_, budget_.read_chunk_bytes, beast::bind_front_handler(&WebSocketClient::on_read, shared_from_this()));
 }
 
 void WebSocketClient::on_read(beast::error_code ec, std::size_t bytes_transferred) {
+    WS_TRACE_END_SAMPLED("read", "read", this, reads_started_);
     boost::ignore_unused(bytes_transferred);
     if (ec == websocket::error::closed) {
         std::cout << "Server closed the connection: " << ws_.reason().reason << std::endl;
-        is_connected_ = false;
+        on_disconnected();
         return;
     } else if (ec) {
         fail(ec, "read");
+        on_disconnected();
         return;
     }
 
-    std::string message = beast::buffers_to_string(buffer_.data());
+    last_read_ = std::chrono::steady_clock::now();
+
+    const auto data = buffer_.data();
+    message_.append(static_cast<const char*>(data.data()), data.size());
     buffer_.consume(buffer_.size());
+    if (shrink_read_buffer_) {
+        // Went idle since the last read; the next prepare starts small again.
+        buffer_.shrink_to_fit();
+        shrink_read_buffer_ = false;
+    }
+    update_read_accounting();
+    if (!ws_.is_message_done()) {
+        do_read();
+        return;
+    }
 
     if (message_callback_) {
-        message_callback_(message);
+        WS_TRACE_SCOPE("message_callback", "callback");
+        message_callback_(message_);
     } else {
-        std::cout << "Received: " << message << std::endl;
+        std::cout << "Received: " << message_ << std::endl;
+    }
+    message_.clear();
+
+    // Keep the capacity for back-to-back large messages; give it back only
+    // after the connection has gone quiet. One timer covers any number of
+    // messages: on_idle pushes itself back while reads keep arriving.
+    if (message_.capacity() > budget_.baseline_bytes && !idle_timer_armed_) {
+        arm_idle_timer(last_read_ + budget_.idle_shrink_after);
     }
 
     do_read();
 }
 
+void WebSocketClient::arm_idle_timer(std::chrono::steady_clock::time_point deadline) {
+    idle_timer_armed_ = true;
+    idle_timer_.expires_at(deadline);
+    idle_timer_.async_wait(beast::bind_front_handler(&WebSocketClient::on_idle, shared_from_this()));
+}
+
+void WebSocketClient::on_idle(beast::error_code ec) {
+    if (ec) return;
+    idle_timer_armed_ = false;
+
+    // A message still being assembled means the connection is not idle; the
+    // timer is armed again once it completes.
+    if (!message_.empty()) return;
+    const auto quiet_until = last_read_ + budget_.idle_shrink_after;
+    if (std::chrono::steady_clock::now() < quiet_until) {
+        arm_idle_timer(quiet_until);
+        return;
+    }
+
+    std::string().swap(message_);
+    message_.reserve(budget_.baseline_bytes);
+    shrink_read_buffer_ = true;
+    update_read_accounting();
+}
+
+void WebSocketClient::release_read_buffers() {
+    buffer_.clear();
+    buffer_.shrink_to_fit();
+    std::string().swap(message_);
+    update_read_accounting();
+}
+
+void WebSocketClient::on_disconnected() {
+    is_connected_ = false;
+    idle_timer_.cancel();
+    idle_timer_armed_ = false;
+    // Drop any partial message so a later connect starts clean.
+    release_read_buffers();
+    if (counted_open_) {
+        counted_open_ = false;
+        g_open_connections.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+void WebSocketClient::update_read_accounting() {
+    // An empty string's inline capacity lives in the object, not the heap.
+    static const std::size_t inline_capacity = std::string().capacity();
+    std::size_t read_bytes = buffer_.capacity() + (message_.capacity() > inline_capacity ? message_.capacity() : 0);
+    if (read_bytes >= accounted_read_bytes_) {
+        g_read_buffer_bytes.fetch_add(read_bytes - accounted_read_bytes_, std::memory_order_relaxed);
+    } else {
+        g_read_buffer_bytes.fetch_sub(accounted_read_bytes_ - read_bytes, std::memory_order_relaxed);
+    }
+    accounted_read_bytes_ = read_bytes;
+}
+
+void WebSocketClient::clear_write_queue() {
+    g_write_queue_bytes.fetch_sub(queued_bytes_, std::memory_order_relaxed);
+    queued_bytes_ = 0;
+    write_queue_.clear();
+}
+
 void WebSocketClient::on_close(beast::error_code ec) {
+    WS_TRACE_END("close", "connection", this);
     if (ec) {
         fail(ec, "close");
     } else {
         std::cout << "Connection closed gracefully. Reason: " << ws_.reason().reason << std::endl;
     }
-    is_connected_ = false;
+    on_disconnected();
 }
\ No newline at end of file
@@ -6,7 +6,11 @@
 #include <boost/beast/websocket.hpp>
 #include <boost/beast/websocket/ssl.hpp>
 #include <boost/asio/strand.hpp>
+#include <boost/asio/steady_timer.hpp>
 #include <boost/asio/ssl.hpp>
+#include <chrono>
+#include <cstdint>
+#include <deque>
 #include <functional>
 #include <memory>
 #include <string>
@@ -20,16 +24,55 @@ using tcp = net::ip::tcp;
 
 using MessageCallback = std::function<void(const std::string&)>;
 
+// Caps what a single connection may hold in memory. Messages are read in
+// chunks of at most read_chunk_bytes and assembled in a separate buffer that
+// shrinks back to baseline_bytes once the connection has been idle.
+struct MemoryBudget {
+    std::size_t max_message_bytes = 16 * 1024 * 1024;  // Beast read_message_max
+    std::size_t read_chunk_bytes = 64 * 1024;          // cap on the Beast read buffer
+    std::size_t baseline_bytes = 4 * 1024;             // message buffer capacity kept when idle
+    std::chrono::milliseconds idle_shrink_after{5000};
+    std::size_t write_buffer_bytes = 16 * 1024;        // one TLS record per masked write
+};
+
+// Process-wide totals across all WebSocketClient instances.
+struct MemoryStats {
+    std::size_t open_connections = 0;    // handshake done, not yet closed or failed
+    std::size_t read_buffer_bytes = 0;   // capacity of read and message buffers
+    std::size_t write_queue_bytes = 0;   // capacity of queued outbound payloads
+};
+
 class WebSocketClient : public std::enable_shared_from_this<WebSocketClient> {
 private:
     tcp::resolver resolver_;  
     websocket::stream<ssl::stream<beast::tcp_stream>> ws_; 
     beast::flat_buffer buffer_;
+    std::string message_;
+    MemoryBudget budget_;
+    net::steady_timer idle_timer_;
+    std::chrono::steady_clock::time_point last_read_;
+    bool idle_timer_armed_ = false;
+    bool shrink_read_buffer_ = false;
+    bool counted_open_ = false;
+    std::size_t accounted_read_bytes_ = 0;
+    std::size_t queued_bytes_ = 0;
     std::string host_;
-    std::string text_;
     MessageCallback message_callback_;
     bool is_connected_ = false;
     bool is_connecting_ = false;
+    bool is_closing_ = false;
+    bool is_writing_ = false;
+    // Per-operation sequence numbers; trace sampling keys on them.
+    std::uint64_t reads_started_ = 0;
+    std::uint64_t writes_started_ = 0;
+
+    // Outbound frames are queued so callers can pipeline sends; Beast allows
+    // only one async_write in flight at a time.
+    struct OutboundMessage {
+        std::string payload;
+        bool is_binary;
+    };
+    std::deque<OutboundMessage> write_queue_;
     ssl::context& ctx_;
 
 public:
@@ -39,7 +82,13 @@ public:
     void send(const std::string& message, bool is_binary = false);
     void close();
     bool is_connected() const;
+    bool is_connecting() const;
+    std::size_t pending_writes() const;
     void set_message_callback(MessageCallback callback);
+    // Must be applied before connect(); Beast's write buffer size cannot
+    // change on an open stream.
+    void set_memory_budget(const MemoryBudget& budget);
+    static MemoryStats memory_stats();
 
 private:
     void on_resolve(beast::error_code ec, tcp::resolver::results_type results);
@@ -50,6 +99,16 @@ private:
     void on_read(beast::error_code ec, std::size_t bytes_transferred);
     void on_close(beast::error_code ec);
     void do_read();
+    void do_send(std::string message, bool is_binary);
+    void do_write();
+    void do_close();
+    void start_close();
+    void on_idle(beast::error_code ec);
+    void arm_idle_timer(std::chrono::steady_clock::time_point deadline);
+    void release_read_buffers();
+    void on_disconnected();
+    void update_read_accounting();
+    void clear_write_queue();
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+#include <boost/asio.hpp>
+#include <boost/asio/ssl.hpp>
+#include "../src/cli/command_handler.h"
+#include "../src/util/root_certificates.hpp"
+#include "local_echo_server.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+class CommandHandlerBatchTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        ctx_ = std::make_unique<ssl::context>(ssl::context::tlsv13_client);
+        load_root_certificates(*ctx_);
+        ctx_->set_verify_mode(ssl::verify_peer);
+        server_.trust(*ctx_);
+        client_ = std::make_shared<WebSocketClient>(ioc_, *ctx_);
+        ASSERT_EQ(::pipe(pipe_), 0);
+        saved_cout_ = std::cout.rdbuf(output_.rdbuf());
+    }
+
+    void TearDown() override {
+        std::cout.rdbuf(saved_cout_);
+        if (pipe_[0] >= 0) ::close(pipe_[0]);
+        if (pipe_[1] >= 0) ::close(pipe_[1]);
+    }
+
+    // Writes `script` into the pipe and closes it, so the handler sees EOF.
+    void WriteScript(const std::string& script) {
+        ASSERT_EQ(::write(pipe_[1], script.data(), script.size()), static_cast<ssize_t>(script.size()));
+        ::close(pipe_[1]);
+        pipe_[1] = -1;
+    }
+
+    // Runs batch mode until the io_context runs out of work; false on timeout.
+    bool RunBatch(CommandHandler& handler, std::chrono::seconds timeout = std::chrono::seconds(10)) {
+        handler.start_batch_mode();
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (!ioc_.stopped()) {
+            if (std::chrono::steady_clock::now() > deadline) return false;
+            ioc_.run_for(std::chrono::milliseconds(50));
+        }
+        return true;
+    }
+
+    LocalEchoServer server_;
+    net::io_context ioc_;
+    std::unique_ptr<ssl::context> ctx_;
+    std::shared_ptr<WebSocketClient> client_;
+    int pipe_[2] = {-1, -1};
+    std::ostringstream output_;
+    std::streambuf* saved_cout_ = nullptr;
+};
+
+TEST_F(CommandHandlerBatchTest, RunsCrlfScriptAndExitsOnceWritesDrain) {
+    CommandHandler handler(client_, ioc_, pipe_[0]);
+    EXPECT_FALSE(handler.is_interactive());
+
+    // CRLF lines, sends issued before the handshake completes, and a final
+    // command with no newline before EOF.
+    WriteScript("connect localhost " + server_.port() + "\r\n"
+                "send hello\r\n"
+                "\r\n"
+                "send  two words\n"
+                "send last");
+    ASSERT_TRUE(RunBatch(handler)) << output_.str();
+
+    EXPECT_EQ(server_.received(), (std::vector<std::string>{"hello", "two words", "last"}));
+    EXPECT_FALSE(client_->is_connected());
+    EXPECT_EQ(client_->pending_writes(), 0u);
+    EXPECT_EQ(output_.str().find("Unknown command"), std::string::npos) << output_.str();
+}
+
+TEST_F(CommandHandlerBatchTest, CloseWhileConnectingIsDeferred) {
+    CommandHandler handler(client_, ioc_, pipe_[0]);
+    WriteScript("connect localhost " + server_.port() + "\n"
+                "send x\n"
+                "close\n");
+    ASSERT_TRUE(RunBatch(handler)) << output_.str();
+
+    EXPECT_EQ(server_.received(), (std::vector<std::string>{"x"}));
+    EXPECT_EQ(output_.str().find("No active connection to close."), std::string::npos) << output_.str();
+    EXPECT_NE(output_.str().find("Connection closed gracefully."), std::string::npos) << output_.str();
+}
+
+TEST_F(CommandHandlerBatchTest, ReadsScriptFromRegularFile) {
+    // Regular files cannot go through the reactor; the handler reads them
+    // with plain reads instead.
+    std::string path = ::testing::TempDir() + "command_handler_test_XXXXXX";
+    int fd = ::mkstemp(&path[0]);
+    ASSERT_GE(fd, 0);
+    std::string script = "connect localhost " + server_.port() + "\r\nsend from file\r\nsend tail";
+    ASSERT_EQ(::write(fd, script.data(), script.size()), static_cast<ssize_t>(script.size()));
+    ::lseek(fd, 0, SEEK_SET);
+
+    CommandHandler handler(client_, ioc_, fd);
+    bool finished = RunBatch(handler);
+    ::close(fd);
+    ::unlink(path.c_str());
+    ASSERT_TRUE(finished) << output_.str();
+
+    EXPECT_EQ(server_.received(), (std::vector<std::string>{"from file", "tail"}));
+}
@@ -0,0 +1,150 @@
+#include <gtest/gtest.h>
+#include "../src/websocket/conflating_dispatcher.h"
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ConflatingDispatcherTest : public ::testing::Test {
+protected:
+    bool WaitForDelivered(const ConflatingDispatcher& dispatcher, std::uint64_t count, int timeout_ms = 2000) {
+        auto start = std::chrono::steady_clock::now();
+        while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(timeout_ms)) {
+            if (dispatcher.stats().delivered >= count) return true;
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        return dispatcher.stats().delivered >= count;
+    }
+
+    std::mutex mutex_;
+    std::map<std::string, std::string> latest_;
+};
+
+TEST_F(ConflatingDispatcherTest, DeliversOnlyLatestPerKey) {
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    std::atomic<bool> first{true};
+
+    ConflatingDispatcher dispatcher(ConflatingDispatcher::json_field("symbol"), [&](const std::string& message) {
+        // Stall on the first message so the burst below piles up.
+        if (first.exchange(false)) released.wait();
+        std::lock_guard<std::mutex> lock(mutex_);
+        latest_[ConflatingDispatcher::json_field("symbol")(message)] = message;
+    });
+
+    dispatcher.push(R"({"symbol":"AAA","px":0})");
+    ASSERT_TRUE(WaitForDelivered(dispatcher, 1));
+    for (int i = 1; i <= 1000; ++i) {
+        dispatcher.push(R"({"symbol":"AAA","px":)" + std::to_string(i) + "}");
+        dispatcher.push(R"({"symbol": "BBB", "px":)" + std::to_string(i) + "}");
+    }
+    release.set_value();
+
+    ASSERT_TRUE(WaitForDelivered(dispatcher, 3));
+    ConflationStats stats = dispatcher.stats();
+    EXPECT_EQ(stats.received, 2001u);
+    EXPECT_EQ(stats.delivered, 3u);
+    EXPECT_EQ(stats.conflated, 1998u);
+    EXPECT_EQ(stats.pending_keys, 0u);
+    EXPECT_GT(stats.ratio(), 600.0);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    EXPECT_EQ(latest_["AAA"], R"({"symbol":"AAA","px":1000})");
+    EXPECT_EQ(latest_["BBB"], R"({"symbol": "BBB", "px":1000})");
+}
+
+TEST_F(ConflatingDispatcherTest, EvictsDeliveredKeysAtCapacity) {
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    std::vector<std::string> delivered;
+
+    ConflatingDispatcher dispatcher(ConflatingDispatcher::json_field("id"), [&](const std::string& message) {
+        released.wait();
+        std::lock_guard<std::mutex> lock(mutex_);
+        delivered.push_back(message);
+    }, 2);
+    dispatcher.push(R"({"id":1})");
+    ASSERT_TRUE(WaitForDelivered(dispatcher, 1));
+
+    // Key 1 has been delivered, so key 3 takes its slot; with 2 and 3 both
+    // pending there is nothing left to evict for key 4.
+    dispatcher.push(R"({"id":2})");
+    dispatcher.push(R"({"id":3})");
+    dispatcher.push(R"({"id":4})");
+    ConflationStats stats = dispatcher.stats();
+    EXPECT_EQ(stats.evicted, 1u);
+    EXPECT_EQ(stats.dropped, 1u);
+    EXPECT_EQ(stats.pending_keys, 2u);
+    release.set_value();
+
+    ASSERT_TRUE(WaitForDelivered(dispatcher, 3));
+    std::lock_guard<std::mutex> lock(mutex_);
+    EXPECT_EQ(delivered, (std::vector<std::string>{R"({"id":1})", R"({"id":2})", R"({"id":3})"}));
+}
+
+TEST_F(ConflatingDispatcherTest, UnkeyedMessagesPassThroughInOrder) {
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    std::vector<std::string> delivered;
+
+    ConflatingDispatcher dispatcher(ConflatingDispatcher::json_field("symbol"), [&](const std::string& message) {
+        released.wait();
+        std::lock_guard<std::mutex> lock(mutex_);
+        delivered.push_back(message);
+    });
+    dispatcher.push(R"({"type":"ack","id":1})");
+    dispatcher.push(R"({"symbol":"AAA","px":1})");
+    dispatcher.push(R"({"type":"ack","id":2})");
+    dispatcher.push(R"({"symbol":"AAA","px":2})");
+    dispatcher.push(R"({"type":"error"})");
+    EXPECT_EQ(dispatcher.stats().pending_keys, 1u);
+    release.set_value();
+
+    ASSERT_TRUE(WaitForDelivered(dispatcher, 4));
+    ConflationStats stats = dispatcher.stats();
+    EXPECT_EQ(stats.conflated, 1u);
+    EXPECT_EQ(stats.delivered, 4u);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    EXPECT_EQ(delivered, (std::vector<std::string>{R"({"type":"ack","id":1})", R"({"symbol":"AAA","px":2})",
+                                                   R"({"type":"ack","id":2})", R"({"type":"error"})"}));
+}
+
+TEST_F(ConflatingDispatcherTest, CapsUnkeyedBacklogDuringBurst) {
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    std::vector<std::string> delivered;
+
+    // A mistyped field leaves every message without a key.
+    ConflatingDispatcher dispatcher(ConflatingDispatcher::json_field("sym"), [&](const std::string& message) {
+        released.wait();
+        std::lock_guard<std::mutex> lock(mutex_);
+        delivered.push_back(message);
+    }, 4096, 8);
+    dispatcher.push(R"({"symbol":"AAA","px":0})");
+    ASSERT_TRUE(WaitForDelivered(dispatcher, 1));
+    for (int i = 1; i <= 10000; ++i) {
+        dispatcher.push(R"({"symbol":"AAA","px":)" + std::to_string(i) + "}");
+    }
+    ConflationStats stats = dispatcher.stats();
+    EXPECT_EQ(stats.unkeyed_dropped, 10000u - 8);
+    EXPECT_EQ(stats.pending_keys, 0u);
+    release.set_value();
+
+    ASSERT_TRUE(WaitForDelivered(dispatcher, 9));
+    std::lock_guard<std::mutex> lock(mutex_);
+    ASSERT_EQ(delivered.size(), 9u);
+    EXPECT_EQ(delivered[0], R"({"symbol":"AAA","px":0})");
+    EXPECT_EQ(delivered[1], R"({"symbol":"AAA","px":9993})");
+    EXPECT_EQ(delivered[8], R"({"symbol":"AAA","px":10000})");
+}
+
+TEST(ConflatingDispatcherKeyTest, JsonField) {
+    auto key = ConflatingDispatcher::json_field("symbol");
+    EXPECT_EQ(key(R"({"symbol":"ETH-USD","bid":1})"), "ETH-USD");
+    EXPECT_EQ(key(R"({"bid":1, "symbol" : 42 })"), "42");
+    EXPECT_EQ(key(R"({"bid":1})"), "");
+}
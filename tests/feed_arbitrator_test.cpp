@@ -0,0 +1,115 @@
+#include <gtest/gtest.h>
+#include <boost/asio/ssl.hpp>
+#include "../src/websocket/feed_arbitrator.h"
+#include <string>
+#include <vector>
+
+class FeedArbitratorTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        arbitrator_ = std::make_shared<FeedArbitrator>(
+            ioc_, ctx_, FeedArbitrator::json_sequence("seq"),
+            [this](const std::string& message) { delivered_.push_back(message); }, 4);
+        arbitrator_->add_endpoint("primary.example.com", "443");
+        arbitrator_->add_endpoint("backup.example.com", "443");
+    }
+
+    static std::string Message(std::uint64_t seq) {
+        return R"({"seq":)" + std::to_string(seq) + "}";
+    }
+
+    net::io_context ioc_;
+    ssl::context ctx_{ssl::context::tlsv13_client};
+    std::shared_ptr<FeedArbitrator> arbitrator_;
+    std::vector<std::string> delivered_;
+};
+
+TEST_F(FeedArbitratorTest, DeliversFirstCopyOnceInOrder) {
+    auto t0 = std::chrono::steady_clock::now();
+    arbitrator_->on_message(0, Message(1), t0);
+    arbitrator_->on_message(1, Message(1), t0 + std::chrono::microseconds(300));
+    arbitrator_->on_message(1, Message(3), t0);
+    arbitrator_->on_message(0, Message(2), t0);
+    arbitrator_->on_message(0, Message(3), t0 + std::chrono::microseconds(100));
+
+    EXPECT_EQ(delivered_, (std::vector<std::string>{Message(1), Message(2), Message(3)}));
+
+    ArbitrationStats stats = arbitrator_->stats();
+    EXPECT_EQ(stats.delivered, 3u);
+    EXPECT_EQ(stats.duplicates, 2u);
+    EXPECT_EQ(stats.gaps, 0u);
+    EXPECT_EQ(stats.endpoints[0].wins, 2u);
+    EXPECT_EQ(stats.endpoints[1].wins, 1u);
+    EXPECT_DOUBLE_EQ(stats.endpoints[0].win_rate(), 2.0 / 3.0);
+    EXPECT_EQ(stats.endpoints[1].mean_lag(), std::chrono::microseconds(300));
+    EXPECT_EQ(stats.endpoints[0].mean_lag(), std::chrono::microseconds(100));
+}
+
+TEST_F(FeedArbitratorTest, SkipsGapBeyondReorderWindow) {
+    arbitrator_->on_message(0, Message(10));
+    arbitrator_->on_message(0, Message(12));
+    arbitrator_->on_message(1, Message(16));  // window of 4: 11..12 can no longer be waited for
+
+    EXPECT_EQ(delivered_, (std::vector<std::string>{Message(10), Message(12)}));
+    arbitrator_->on_message(1, Message(11));  // too late, already given up
+    arbitrator_->on_message(0, Message(13));
+    arbitrator_->on_message(0, Message(14));
+    arbitrator_->on_message(0, Message(15));
+
+    EXPECT_EQ(delivered_.back(), Message(16));
+    ArbitrationStats stats = arbitrator_->stats();
+    EXPECT_EQ(stats.delivered, 6u);
+    EXPECT_EQ(stats.gaps, 1u);
+    EXPECT_EQ(stats.duplicates, 1u);
+    EXPECT_EQ(stats.endpoints[1].losses, 1u);
+    EXPECT_EQ(stats.endpoints[1].too_late, 1u);
+}
+
+TEST_F(FeedArbitratorTest, CountsCopiesBehindHistoryAsLosses) {
+    // The backup trails by more than the 16-sequence arrival history, so its
+    // copies can only be counted as too-late losses, with no lag sample.
+    auto t0 = std::chrono::steady_clock::now();
+    for (std::uint64_t seq = 1; seq <= 20; ++seq) {
+        arbitrator_->on_message(0, Message(seq), t0);
+    }
+    arbitrator_->on_message(1, Message(1), t0 + std::chrono::milliseconds(5));
+    arbitrator_->on_message(1, Message(20), t0 + std::chrono::milliseconds(1));
+
+    ArbitrationStats stats = arbitrator_->stats();
+    EXPECT_EQ(stats.endpoints[0].wins, 20u);
+    EXPECT_EQ(stats.endpoints[1].wins, 0u);
+    EXPECT_EQ(stats.endpoints[1].losses, 2u);
+    EXPECT_EQ(stats.endpoints[1].too_late, 1u);
+    EXPECT_DOUBLE_EQ(stats.endpoints[1].win_rate(), 0.0);
+    EXPECT_EQ(stats.endpoints[1].mean_lag(), std::chrono::milliseconds(1));
+}
+
+TEST_F(FeedArbitratorTest, DeclaresGapAfterTimeoutWhenFeedPauses) {
+    arbitrator_->on_message(0, Message(1));
+    arbitrator_->on_message(0, Message(3));  // 2 is lost everywhere, then the feed goes quiet
+    arbitrator_->on_message(1, Message(4));
+    EXPECT_EQ(delivered_, (std::vector<std::string>{Message(1)}));
+
+    ioc_.run_for(std::chrono::milliseconds(20));
+    EXPECT_EQ(delivered_.size(), 1u) << "gap declared before the 100 ms timeout";
+
+    ioc_.run_for(std::chrono::seconds(1));
+    EXPECT_EQ(delivered_, (std::vector<std::string>{Message(1), Message(3), Message(4)}));
+    ArbitrationStats stats = arbitrator_->stats();
+    EXPECT_EQ(stats.gaps, 1u);
+    EXPECT_EQ(stats.delivered, 3u);
+
+    arbitrator_->on_message(1, Message(2));
+    arbitrator_->on_message(0, Message(5));
+    EXPECT_EQ(delivered_.back(), Message(5));
+    EXPECT_EQ(arbitrator_->stats().endpoints[1].too_late, 1u);
+}
+
+TEST_F(FeedArbitratorTest, PassesUnsequencedMessagesThrough) {
+    arbitrator_->on_message(0, Message(1));
+    arbitrator_->on_message(0, R"({"type":"subscribed"})");
+    arbitrator_->on_message(1, R"({"type":"heartbeat"})");
+    EXPECT_EQ(delivered_, (std::vector<std::string>{Message(1), R"({"type":"subscribed"})", R"({"type":"heartbeat"})"}));
+    EXPECT_EQ(arbitrator_->stats().unsequenced, 2u);
+    EXPECT_EQ(arbitrator_->stats().delivered, 1u);
+}
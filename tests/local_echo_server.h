@@ -0,0 +1,112 @@
+#ifndef WEBSOCKET_TESTS_LOCAL_ECHO_SERVER_H
+#define WEBSOCKET_TESTS_LOCAL_ECHO_SERVER_H
+
+#include "../src/websocket/websocket_client.h"
+#include <openssl/x509v3.h>
+#include <sys/socket.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// A TLS WebSocket echo server on 127.0.0.1 with a certificate for
+// "localhost" generated at startup. Serves one connection, on its own thread,
+// so tests and benchmarks can run the client without the network.
+class LocalEchoServer {
+public:
+    explicit LocalEchoServer(bool record_messages = true)
+        : server_ctx_(ssl::context::tlsv13_server), record_messages_(record_messages) {
+        EVP_PKEY* key = EVP_EC_gen("P-256");
+        X509* cert = X509_new();
+        ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+        X509_gmtime_adj(X509_getm_notBefore(cert), -60);
+        X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+        X509_set_pubkey(cert, key);
+        X509_NAME* name = X509_get_subject_name(cert);
+        X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char*>("localhost"), -1, -1, 0);
+        X509_set_issuer_name(cert, name);
+        X509_EXTENSION* san = X509V3_EXT_conf_nid(nullptr, nullptr, NID_subject_alt_name, "DNS:localhost");
+        X509_add_ext(cert, san, -1);
+        X509_EXTENSION_free(san);
+        X509_sign(cert, key, EVP_sha256());
+
+        SSL_CTX_use_certificate(server_ctx_.native_handle(), cert);
+        SSL_CTX_use_PrivateKey(server_ctx_.native_handle(), key);
+        cert_ = cert;
+        EVP_PKEY_free(key);
+
+        acceptor_.open(tcp::v4());
+        acceptor_.bind({net::ip::make_address("127.0.0.1"), 0});
+        acceptor_.listen();
+        thread_ = std::thread([this]() { serve(); });
+    }
+
+    ~LocalEchoServer() {
+        // Unblocks accept() or read() if the client never connected or hung up.
+        stopping_ = true;
+        ::shutdown(acceptor_.native_handle(), SHUT_RDWR);
+        ::shutdown(session_fd_.load(), SHUT_RDWR);
+        thread_.join();
+        X509_free(cert_);
+    }
+
+    LocalEchoServer(const LocalEchoServer&) = delete;
+    LocalEchoServer& operator=(const LocalEchoServer&) = delete;
+
+    // Lets a client context verify this server's certificate.
+    void trust(ssl::context& ctx) const {
+        X509_STORE_add_cert(SSL_CTX_get_cert_store(ctx.native_handle()), cert_);
+    }
+
+    std::string port() const {
+        return std::to_string(acceptor_.local_endpoint().port());
+    }
+
+    // Every message the server has read, in order.
+    std::vector<std::string> received() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return received_;
+    }
+
+private:
+    void serve() {
+        beast::error_code ec;
+        websocket::stream<ssl::stream<tcp::socket>> ws(ioc_, server_ctx_);
+        acceptor_.accept(beast::get_lowest_layer(ws), ec);
+        if (ec) return;
+        session_fd_ = beast::get_lowest_layer(ws).native_handle();
+        beast::get_lowest_layer(ws).set_option(tcp::no_delay(true), ec);
+        if (stopping_) return;
+        ws.next_layer().handshake(ssl::stream_base::server, ec);
+        if (!ec) ws.accept(ec);
+        ws.read_message_max(0);
+
+        beast::flat_buffer buffer;
+        while (!ec) {
+            ws.read(buffer, ec);
+            if (ec) break;
+            if (record_messages_) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                received_.push_back(beast::buffers_to_string(buffer.data()));
+            }
+            ws.text(ws.got_text());
+            ws.write(buffer.data(), ec);
+            buffer.consume(buffer.size());
+        }
+    }
+
+    net::io_context ioc_;
+    ssl::context server_ctx_;
+    tcp::acceptor acceptor_{ioc_};
+    X509* cert_ = nullptr;
+    const bool record_messages_;
+    std::atomic<bool> stopping_{false};
+    std::atomic<int> session_fd_{-1};
+    std::thread thread_;
+
+    mutable std::mutex mutex_;
+    std::vector<std::string> received_;
+};
+
+#endif
@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+#include "../src/util/trace.h"
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+namespace {
+
+std::string ReadFile(const std::string& path) {
+    std::ifstream in(path);
+    std::stringstream ss;
+    ss << in.rdbuf();
+    return ss.str();
+}
+
+}
+
+TEST(TraceTest, WritesChromeTraceJson) {
+    const std::string path = ::testing::TempDir() + "trace_test.json";
+    [[maybe_unused]] int id = 0;
+
+    trace::start();
+    {
+        WS_TRACE_SCOPE("scoped_work", "test");
+    }
+    WS_TRACE_BEGIN("async_work", "test", &id);
+    WS_TRACE_END("async_work", "test", &id);
+    trace::stop();
+    WS_TRACE_SCOPE("after_stop", "test");
+
+    ASSERT_TRUE(trace::write_chrome_json(path));
+    std::string json = ReadFile(path);
+    std::remove(path.c_str());
+
+    EXPECT_EQ(json.rfind("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", 0), 0u);
+#if WS_TRACE_ENABLED
+    EXPECT_NE(json.find("\"name\":\"scoped_work\",\"cat\":\"test\",\"ph\":\"X\""), std::string::npos);
+    EXPECT_NE(json.find("\"name\":\"async_work\",\"cat\":\"test\",\"ph\":\"b\""), std::string::npos);
+    EXPECT_NE(json.find("\"name\":\"async_work\",\"cat\":\"test\",\"ph\":\"e\""), std::string::npos);
+#endif
+    EXPECT_EQ(json.find("after_stop"), std::string::npos);
+}
+
+TEST(TraceTest, SamplesOneInN) {
+    trace::start(4);
+    EXPECT_TRUE(trace::sampled(0));
+    EXPECT_FALSE(trace::sampled(1));
+    EXPECT_TRUE(trace::sampled(8));
+    trace::stop();
+}
+
+#if WS_TRACE_ENABLED
+TEST(TraceTest, DumpsWrappedRingWhileRecording) {
+    const std::string path = ::testing::TempDir() + "trace_wrap_test.json";
+    auto count_events = [](const std::string& json) {
+        std::size_t events = 0;
+        for (std::size_t pos = json.find("{\"name\":"); pos != std::string::npos; pos = json.find("{\"name\":", pos + 1)) {
+            // A torn slot would show up as some other name (or crash).
+            EXPECT_EQ(json.compare(pos, 23, "{\"name\":\"wrapped_work\","), 0);
+            ++events;
+        }
+        return events;
+    };
+
+    trace::start();
+    std::atomic<bool> done{false};
+    std::thread writer([&done]() {
+        // Wrap the ring, then keep overwriting its oldest slots during the dumps.
+        for (std::size_t i = 0; i < trace::kEventsPerThread + 1 || !done.load(); ++i) {
+            WS_TRACE_SCOPE("wrapped_work", "test");
+        }
+    });
+    for (int i = 0; i < 5; ++i) {
+        ASSERT_TRUE(trace::write_chrome_json(path));
+        count_events(ReadFile(path));
+    }
+    done = true;
+    writer.join();
+    trace::stop();
+
+    // Quiescent now: the whole ring is written out.
+    ASSERT_TRUE(trace::write_chrome_json(path));
+    EXPECT_EQ(count_events(ReadFile(path)), trace::kEventsPerThread);
+    std::remove(path.c_str());
+}
+#endif
@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+#include "../src/util/util.h"
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// The std::getline loop split() used to be built on.
+std::vector<std::string> GetlineSplit(const std::string& str, char delimiter) {
+    std::vector<std::string> tokens;
+    std::istringstream stream(str);
+    std::string token;
+    while (std::getline(stream, token, delimiter)) tokens.push_back(token);
+    return tokens;
+}
+
+}
+
+TEST(UtilTest, SplitMatchesGetline) {
+    for (const std::string input : {"", ",", ",,", "a", "a,b", "a,b,", "a,,b", ",a", "a,,", " a , b "}) {
+        EXPECT_EQ(util::split(input, ','), GetlineSplit(input, ',')) << '"' << input << '"';
+    }
+}
+
+TEST(UtilTest, SplitKeepsEmptyTokensButNoTrailingOne) {
+    EXPECT_EQ(util::split("a,b,", ','), (std::vector<std::string>{"a", "b"}));
+    EXPECT_EQ(util::split("a,,b", ','), (std::vector<std::string>{"a", "", "b"}));
+    EXPECT_EQ(util::split(",a", ','), (std::vector<std::string>{"", "a"}));
+    EXPECT_TRUE(util::split("", ',').empty());
+}
+
+TEST(UtilTest, ViewVariantsAgreeWithCopyingOnes) {
+    for (const std::string input : {"", "   ", "x", "  x", "x  ", " \t\r\nx y\n ", "a b c"}) {
+        EXPECT_EQ(std::string(util::trimView(input)), util::trim(input)) << '"' << input << '"';
+
+        std::vector<std::string> views;
+        for (std::string_view token : util::splitView(input, ' ')) views.emplace_back(token);
+        EXPECT_EQ(views, util::split(input, ' ')) << '"' << input << '"';
+    }
+}
+
+TEST(UtilTest, Base64PadsEveryLengthModThree) {
+    // RFC 4648 section 10 test vectors.
+    const std::pair<std::string, std::string> vectors[] = {
+        {"", ""},         {"f", "Zg=="},         {"fo", "Zm8="},         {"foo", "Zm9v"},
+        {"foob", "Zm9vYg=="}, {"fooba", "Zm9vYmE="}, {"foobar", "Zm9vYmFy"},
+    };
+    for (const auto& [plain, encoded] : vectors) {
+        EXPECT_EQ(util::base64Encode(plain), encoded);
+        EXPECT_EQ(util::base64Decode(encoded), plain);
+    }
+
+    std::string binary;
+    for (int i = 0; i < 256; ++i) binary.push_back(static_cast<char>(i));
+    EXPECT_EQ(util::base64Decode(util::base64Encode(binary)), binary);
+}
+
+TEST(UtilTest, AcceptKeyMatchesRfc6455) {
+    EXPECT_EQ(util::computeAcceptKey("dGhlIHNhbXBsZSBub25jZQ=="), "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=");
+
+    char out[util::kAcceptKeySize];
+    util::computeAcceptKey(std::string_view("dGhlIHNhbXBsZSBub25jZQ=="), out);
+    EXPECT_EQ(std::string(out, sizeof(out)), "s3pPLMBiTxaQ9kYGzzhZRbK+xOo=");
+}
+
+TEST(UtilTest, WebSocketKeysAreSixteenRandomBytes) {
+    std::set<std::string> keys;
+    // Enough keys to refill the random pool several times.
+    for (int i = 0; i < 100; ++i) {
+        std::string key = util::generateWebSocketKey();
+        ASSERT_EQ(key.size(), 24u);
+        EXPECT_EQ(key.substr(22), "==");
+        EXPECT_EQ(util::base64Decode(key).size(), 16u);
+        keys.insert(key);
+    }
+    EXPECT_EQ(keys.size(), 100u);
+}
+
+TEST(UtilTest, JsonFieldIsTopLevelOnly) {
+    EXPECT_EQ(util::jsonField(R"({"symbol":"ETH-USD","bid":1})", "symbol"), "ETH-USD");
+    EXPECT_EQ(util::jsonField(R"({"bid":1, "seq" : 42 })", "seq"), "42");
+    EXPECT_EQ(util::jsonField(R"({"data":{"symbol":"X"},"symbol":"Y"})", "symbol"), "Y");
+    EXPECT_EQ(util::jsonField(R"({"list":[{"symbol":"X"}],"symbol":"Y"})", "symbol"), "Y");
+    EXPECT_EQ(util::jsonField(R"({"note":"\"symbol\":\"X\"","symbol":"Y"})", "symbol"), "Y");
+    EXPECT_EQ(util::jsonField(R"({"data":{"symbol":"X"}})", "symbol"), "");
+    EXPECT_EQ(util::jsonField(R"(["symbol","X"])", "symbol"), "");
+    EXPECT_EQ(util::jsonField(R"({"symbol":"unterminated)", "symbol"), "");
+}
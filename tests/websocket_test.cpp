@@ -3,6 +3,7 @@
 #include <boost/asio/ssl.hpp>
 #include "../src/websocket/websocket_client.h"
 #include "../src/util/root_certificates.hpp"
+#include "local_echo_server.h"
 #include <chrono>
 #include <thread>
 #include <deque>
@@ -107,6 +108,123 @@ TEST_F(WebSocketClientTest, ConnectFailure) {
     EXPECT_FALSE(WaitForCondition([this]() { return client_->is_connected(); }, 2000)) << "Should not connect";
 }
 
+class WebSocketClientLocalTest : public WebSocketClientTest {
+protected:
+    void SetUp() override {
+        WebSocketClientTest::SetUp();
+        server_.trust(*ctx_);
+        client_->set_message_callback([this](const std::string& message) {
+            received_messages_.push_back(message);
+        });
+    }
+
+    void Connect(const MemoryBudget& budget) {
+        client_->set_memory_budget(budget);
+        client_->connect("localhost", server_.port());
+        ASSERT_TRUE(RunUntil([this]() { return client_->is_connected(); })) << "Local connection failed";
+    }
+
+    // Unlike WaitForCondition, runs the loop flat out: large messages arrive
+    // as many small reads.
+    bool RunUntil(std::function<bool()> condition, int timeout_ms = 5000) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+        while (!condition() && std::chrono::steady_clock::now() < deadline) {
+            ioc_.run_for(std::chrono::milliseconds(10));
+        }
+        return condition();
+    }
+
+    static std::string Payload(std::size_t size) {
+        std::string payload(size, '\0');
+        for (std::size_t i = 0; i < size; ++i) payload[i] = static_cast<char>('a' + i % 26);
+        return payload;
+    }
+
+    LocalEchoServer server_;
+};
+
+TEST_F(WebSocketClientLocalTest, ReassemblesMessageAcrossReadChunks) {
+    MemoryBudget budget;
+    budget.read_chunk_bytes = 4096;
+    Connect(budget);
+
+    const std::string payload = Payload(1024 * 1024 + 123);
+    client_->send(payload, false);
+    ASSERT_TRUE(RunUntil([this]() { return !received_messages_.empty(); }));
+    EXPECT_EQ(received_messages_.front().size(), payload.size());
+    EXPECT_TRUE(received_messages_.front() == payload);
+
+    client_->send("small", false);
+    ASSERT_TRUE(RunUntil([this]() { return received_messages_.size() == 2; }));
+    EXPECT_EQ(received_messages_.back(), "small");
+}
+
+TEST_F(WebSocketClientLocalTest, PipelinedSendsWhileConnecting) {
+    client_->connect("localhost", server_.port());
+    ASSERT_TRUE(client_->is_connecting());
+
+    // Queued before the handshake completes and flushed in order afterwards.
+    client_->send("first", false);
+    client_->send("second", false);
+    client_->send("third", false);
+    EXPECT_TRUE(RunUntil([this]() { return received_messages_.size() == 3; })) << "Did not receive pipelined echoes";
+    EXPECT_EQ(received_messages_, (std::deque<std::string>{"first", "second", "third"}));
+    EXPECT_EQ(client_->pending_writes(), 0u);
+}
+
+TEST_F(WebSocketClientLocalTest, ReadMessageMaxFailsConnectionAndReleasesBuffers) {
+    const std::size_t read_bytes_before = WebSocketClient::memory_stats().read_buffer_bytes;
+    const std::size_t open_before = WebSocketClient::memory_stats().open_connections;
+
+    MemoryBudget budget;
+    budget.max_message_bytes = 64 * 1024;
+    budget.read_chunk_bytes = 4096;
+    Connect(budget);
+    EXPECT_EQ(WebSocketClient::memory_stats().open_connections, open_before + 1);
+
+    client_->send(Payload(48 * 1024), false);
+    ASSERT_TRUE(RunUntil([this]() { return received_messages_.size() == 1; }));
+
+    // The echo exceeds read_message_max: Beast fails the read part-way in.
+    client_->send(Payload(128 * 1024), false);
+    ASSERT_TRUE(RunUntil([this]() { return !client_->is_connected(); }));
+    EXPECT_EQ(received_messages_.size(), 1u);
+    EXPECT_EQ(WebSocketClient::memory_stats().open_connections, open_before);
+    EXPECT_EQ(WebSocketClient::memory_stats().read_buffer_bytes, read_bytes_before);
+}
+
+TEST_F(WebSocketClientLocalTest, ShrinksMessageBufferWhenIdle) {
+    const std::size_t read_bytes_before = WebSocketClient::memory_stats().read_buffer_bytes;
+
+    MemoryBudget budget;
+    budget.read_chunk_bytes = 4096;
+    budget.idle_shrink_after = std::chrono::milliseconds(200);
+    Connect(budget);
+
+    client_->send(Payload(256 * 1024), false);
+    ASSERT_TRUE(RunUntil([this]() { return received_messages_.size() == 1; }));
+    EXPECT_GE(WebSocketClient::memory_stats().read_buffer_bytes - read_bytes_before, 256u * 1024);
+
+    // Traffic inside the idle window pushes the shrink back.
+    for (int i = 0; i < 3; ++i) {
+        ioc_.run_for(std::chrono::milliseconds(100));
+        client_->send("keepalive", false);
+        ASSERT_TRUE(RunUntil([this, i]() { return received_messages_.size() == static_cast<std::size_t>(i) + 2; }));
+        EXPECT_GE(WebSocketClient::memory_stats().read_buffer_bytes - read_bytes_before, 256u * 1024);
+    }
+
+    ASSERT_TRUE(RunUntil([&]() {
+        return WebSocketClient::memory_stats().read_buffer_bytes - read_bytes_before
+               <= budget.baseline_bytes + budget.read_chunk_bytes;
+    }, 2000)) << "Message buffer was not shrunk after going idle";
+
+    // The read buffer is pinned by the pending read; the next message frees it.
+    client_->send("wake", false);
+    ASSERT_TRUE(RunUntil([this]() { return received_messages_.size() == 5; }));
+    EXPECT_LE(WebSocketClient::memory_stats().read_buffer_bytes - read_bytes_before, budget.baseline_bytes + 512);
+    EXPECT_TRUE(client_->is_connected());
+}
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();